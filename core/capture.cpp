@@ -0,0 +1,147 @@
+/*
+osap/capture.cpp
+
+datagram capture, for seeing what goes where 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "capture.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif 
+
+OSAP_THREAD_LOCAL boolean captureEnabled = false;
+
+// the ring, and where it lives, 
+OSAP_THREAD_LOCAL captureRecord* captureRing = nullptr;
+OSAP_THREAD_LOCAL uint32_t captureNumRecords = 0;
+OSAP_THREAD_LOCAL uint32_t captureWriteIndex = 0;
+OSAP_THREAD_LOCAL captureFileHeader* captureFile = nullptr;
+OSAP_THREAD_LOCAL size_t captureFileSize = 0;
+// and the filter, 
+OSAP_THREAD_LOCAL Vertex* captureFilterVt = nullptr;
+OSAP_THREAD_LOCAL uint8_t captureFilterKey = 0;
+OSAP_THREAD_LOCAL uint8_t captureFilterPoints = CAPTURE_POINT_ALL;
+
+boolean captureBegin(uint16_t numRecords){
+  captureEnd();
+  if(numRecords == 0) return false;
+  captureRing = new captureRecord[numRecords];
+  for(uint16_t r = 0; r < numRecords; r ++){
+    captureRing[r].seq = 0;
+  }
+  captureNumRecords = numRecords;
+  captureWriteIndex = 0;
+  captureEnabled = true;
+  return true;
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+boolean captureBeginFile(const char* path, uint32_t numRecords){
+  captureEnd();
+  if(numRecords == 0) return false;
+  size_t size = sizeof(captureFileHeader) + numRecords * sizeof(captureRecord);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) return false;
+  if(ftruncate(fd, size) != 0){
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) return false;
+  captureFile = (captureFileHeader*)map;
+  captureFileSize = size;
+  captureFile->magic = CAPTURE_FILE_MAGIC;
+  captureFile->version = CAPTURE_FILE_VERSION;
+  captureFile->headerSize = sizeof(captureFileHeader);
+  captureFile->snapLen = OSAP_CAPTURE_SNAPLEN;
+  captureFile->recordSize = sizeof(captureRecord);
+  captureFile->numRecords = numRecords;
+  captureFile->writeIndex = 0;
+  captureRing = (captureRecord*)(captureFile + 1);
+  captureNumRecords = numRecords;
+  captureWriteIndex = 0;
+  captureEnabled = true;
+  return true;
+}
+#endif 
+
+void captureEnd(void){
+  captureEnabled = false;
+#if defined(__linux__) || defined(__APPLE__)
+  if(captureFile != nullptr){
+    munmap(captureFile, captureFileSize);
+    captureFile = nullptr;
+    captureRing = nullptr;
+  }
+#endif 
+  if(captureRing != nullptr){
+    delete[] captureRing;
+    captureRing = nullptr;
+  }
+  captureNumRecords = 0;
+}
+
+void captureSetFilter(Vertex* vt, uint8_t key, uint8_t points){
+  captureFilterVt = vt;
+  captureFilterKey = key;
+  captureFilterPoints = points;
+}
+
+void captureDatagram(uint8_t point, Vertex* vt, uint8_t* data, uint16_t len, uint16_t ptr, uint8_t key){
+  if(captureRing == nullptr) return;
+  if(!(point & captureFilterPoints)) return;
+  if(captureFilterVt != nullptr && captureFilterVt != vt) return;
+  if(captureFilterKey != 0 && captureFilterKey != key) return;
+  // claim a record, invalidate it, fill it, publish it, 
+  uint32_t index = captureWriteIndex ++;
+  captureRecord* rec = &(captureRing[index % captureNumRecords]);
+  __atomic_store_n(&(rec->seq), 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#if defined(__linux__) || defined(__APPLE__)
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  rec->tsSec = tv.tv_sec;
+  rec->tsUsec = tv.tv_usec;
+#else 
+  uint32_t us = micros();
+  rec->tsSec = us / 1000000;
+  rec->tsUsec = us % 1000000;
+#endif 
+  rec->origLen = len;
+  rec->inclLen = (len > OSAP_CAPTURE_SNAPLEN ? OSAP_CAPTURE_SNAPLEN : len);
+  rec->vtIndice = vt->indice;
+  rec->vtType = vt->type;
+  rec->point = point;
+  rec->key = key;
+  rec->pad = 0;
+  rec->ptr = ptr;
+  memcpy(rec->data, data, rec->inclLen);
+  __atomic_store_n(&(rec->seq), index + 1, __ATOMIC_RELEASE);
+  if(captureFile != nullptr) __atomic_store_n(&(captureFile->writeIndex), index + 1, __ATOMIC_RELEASE);
+}
+
+uint16_t captureRead(captureRecord* out, uint16_t max, uint32_t* index){
+  if(captureRing == nullptr) return 0;
+  // skip what's been overwritten, 
+  if(captureWriteIndex - *index > captureNumRecords) *index = captureWriteIndex - captureNumRecords;
+  uint16_t count = 0;
+  while(count < max && *index != captureWriteIndex){
+    captureRecord* rec = &(captureRing[*index % captureNumRecords]);
+    memcpy(&(out[count ++]), rec, sizeof(captureRecord));
+    (*index) ++;
+  }
+  return count;
+}
@@ -0,0 +1,85 @@
+/*
+osap/capture.h
+
+datagram capture, for seeing what goes where 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include "vertex.h"
+
+// bytes of each datagram we keep, 
+#ifndef OSAP_CAPTURE_SNAPLEN
+#define OSAP_CAPTURE_SNAPLEN 64 
+#endif 
+
+// where in the graph a datagram was seen, (also bits for the filter's points mask) 
+#define CAPTURE_POINT_ITEM 1          // handled by the loop, at item->vt 
+#define CAPTURE_POINT_PORT_TX 2       // sent out of a vport, 
+#define CAPTURE_POINT_BUS_TX 4        // forwarded out of a vbus, 
+#define CAPTURE_POINT_ALL 7 
+
+// one per datagram seen, w/ our hop metadata ahead of the (snapped) datagram 
+typedef struct captureRecord {
+  uint32_t seq;                 // index + 1 once written, 0 while being written 
+  uint32_t tsSec;
+  uint32_t tsUsec;
+  uint32_t inclLen;             // bytes of data[] that are valid, 
+  uint32_t origLen;             // datagram length, 
+  uint16_t vtIndice;
+  uint8_t vtType;
+  uint8_t point;
+  uint8_t key;                  // the instruction being handled / forwarded, 
+  uint8_t pad;
+  uint16_t ptr;                 // where the datagram's ptr was, 0 where not known (bus tx) 
+  uint8_t data[OSAP_CAPTURE_SNAPLEN];
+} captureRecord;
+
+// host files are our own format, not pcap (a ring can't be, pcap files are append-only): 
+// a captureFileHeader, then numRecords captureRecords of recordSize bytes each, all in the 
+// writer's byte order, w/ record (i % numRecords) holding the i'th datagram... readers tail it 
+// by watching writeIndex, and checking each record's seq before and after copying it 
+// the magic reads "OSCP" in the file on little-endian writers, & comes out swapped on a reader w/ the other order 
+#define CAPTURE_FILE_MAGIC 0x5043534f 
+#define CAPTURE_FILE_VERSION 1 
+
+typedef struct captureFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;          // records start here, 
+  uint32_t snapLen;             // OSAP_CAPTURE_SNAPLEN, the size of each record's data[] 
+  uint32_t recordSize;
+  uint32_t numRecords;
+  uint32_t writeIndex;          // total records ever written, 
+} captureFileHeader;
+
+// the only thing the hooks check, 
+extern OSAP_THREAD_LOCAL boolean captureEnabled;
+
+// starts capturing into a ring of numRecords in ram, 
+boolean captureBegin(uint16_t numRecords);
+#if defined(__linux__) || defined(__APPLE__)
+// or, into a ring in a file that other processes can tail, 
+boolean captureBeginFile(const char* path, uint32_t numRecords);
+#endif 
+void captureEnd(void);
+// only datagrams at this vertex (nullptr for any), w/ this key (0 for any), at these points are kept 
+void captureSetFilter(Vertex* vt, uint8_t key, uint8_t points);
+// copies out the ram ring's records since *index (which is updated), returns # copied 
+uint16_t captureRead(captureRecord* out, uint16_t max, uint32_t* index);
+// what the hooks call, 
+void captureDatagram(uint8_t point, Vertex* vt, uint8_t* data, uint16_t len, uint16_t ptr, uint8_t key);
+
+// the hooks: when capture is off, this is one (predicted not-taken) branch 
+#define OSAP_CAPTURE(point, vt, data, len, ptr, key) do { if(__builtin_expect(captureEnabled, 0)) captureDatagram(point, vt, data, len, ptr, key); } while(0)
+
+#endif 
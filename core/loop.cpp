@@ -15,18 +15,21 @@ no warranty is provided, and users accept all liability.
 #include "loop.h"
 #include "packets.h"
 #include "osap.h"
+#include "capture.h"
 
 #define MAX_ITEMS_PER_LOOP 32
 //#define LOOP_DEBUG
 
 // we'll stack up to 64 messages to handle per loop, 
 // more items would cause issues: will throw errors and design circular looping at that point 
-stackItem* itemList[MAX_ITEMS_PER_LOOP];
-uint16_t itemListLen = 0;
+OSAP_THREAD_LOCAL stackItem* itemList[MAX_ITEMS_PER_LOOP];
+OSAP_THREAD_LOCAL uint16_t itemListLen = 0;
 
 void listSetupRecursor(Vertex* vt){
   // run the vertex' loop... but not if it's the root, yar 
   if(vt->type != VT_TYPE_ROOT) vt->loop();
+  // busses get to drain their per-drop queues before we collect what's left, 
+  if(vt->type == VT_TYPE_VBUS) vt->vbus->serviceOutputQueues();
   // for each input / output stack, try to collect all items... 
   // alright I'm doing this collect... but want a kind of pickup-where-you-left-off thing, 
   // so that we can have a fixed-length loop, i.e. 64 items per, but still do fairness... 
@@ -69,9 +72,9 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
       case PK_SIB:
         // check validity of route & shift our reference vt,
         if(vt->parent == nullptr){
-          OSAP::error("no parent at " + vt->name + " during sib transport"); return true;
+          OSAP_ERROR(TRACE_SIB_NO_PARENT, MINOR, vt); return true;
         } else if (arg >= vt->parent->numChildren){
-          OSAP::error("no sibling " + String(arg) + " at " + vt->name + " during sib transport"); return true;
+          OSAP_ERROR(TRACE_SIB_NO_SIBLING, MINOR, vt, arg); return true;
         } else {
           // this is it: we go fwds to this vt & end-of-switch statements increment ptrs
           vt = vt->parent->children[arg];
@@ -79,7 +82,7 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
         break;
       case PK_PARENT:
         if(vt->parent == nullptr){
-          OSAP::error("no parent at " + vt->name + " during parent transport"); return true;
+          OSAP_ERROR(TRACE_PARENT_NO_PARENT, MINOR, vt); return true;
         } else {
           // likewise... 
           vt = vt->parent;
@@ -87,7 +90,7 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
         break;
       case PK_CHILD:
         if(arg >= vt->numChildren){
-          OSAP::error("no child " + String(arg) + " at " + vt->name + " during child transport"); return true;
+          OSAP_ERROR(TRACE_CHILD_NO_CHILD, MINOR, vt, arg); return true;
         } else {
           // again, just walk fwds... 
           vt = vt->children[arg];
@@ -101,6 +104,10 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
       case PK_PINGREQ:
       case PK_SCOPEREQ:
       case PK_LLESCAPE:
+        // bus drops each get a quota of the bus' stack, so one slow / offline drop can't fill it for all the others, 
+        if(PK_READKEY(item->data[fwdPtr]) == PK_BFWD && vt->type == VT_TYPE_VBUS && vt->vbus->queuedFor(arg) >= vt->vbus->dropQuota){
+          return false;
+        }
         // check / transport...
         if(stackEmptySlot(vt, VT_STACK_DESTINATION)){
           // walk the ptr fwds, 
@@ -113,7 +120,7 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
           return false; 
         }
       default:
-        OSAP::error("internal transport failure, ptr walk ends at unknown key");
+        OSAP_ERROR(TRACE_TRANSPORT_BAD_KEY, MINOR, vt, PK_READKEY(item->data[fwdPtr]));
         return true;
     } // end switch 
     fwdPtr += 2;
@@ -125,15 +132,15 @@ boolean internalTransport(stackItem* item, uint16_t ptr){
 
 // -------------------------------------------------------- LOOP Begins Here 
 
-// ... would be breadth-first, ideally 
-void osapLoop(Vertex* root){
+// ... would be breadth-first, ideally, returns the # of items it picked up 
+uint16_t osapLoop(Vertex* root){
   // we want to build a list of items, recursing through... 
   itemListLen = 0;
   listSetupRecursor(root);
   // check now if items are nearly oversized...
   // see notes in the log from 2022-06-22 if this error occurs, 
   if(itemListLen >= MAX_ITEMS_PER_LOOP - 2){
-    OSAP::error("loop items exceeds " + String(MAX_ITEMS_PER_LOOP) + ", breaking per-loop transport properties... pls fix", HALTING);
+    OSAP_ERROR(TRACE_LOOP_OVERFULL, HALTING, root, itemListLen, MAX_ITEMS_PER_LOOP);
   }
   // stash high-water mark,
   if(itemListLen > OSAP::loopItemsHighWaterMark) OSAP::loopItemsHighWaterMark = itemListLen;
@@ -145,23 +152,26 @@ void osapLoop(Vertex* root){
   for(uint16_t i = 0; i < itemListLen; i ++){
     osapItemHandler(itemList[i]);
   }
+  return itemListLen;
 }
 
 void osapItemHandler(stackItem* item){
+  // items on loan to their vertex are left alone, whoever holds 'em clears 'em 
+  if(item->borrowed) return;
   // clear dead items, 
   if(item->timeToDeath < 0){
-    OSAP::debug(  "item at " + item->vt->name + " times out w/ " + String(item->timeToDeath) + 
-                  " ms to live, of " + String(ts_readUint16(item->data, 0)) + " ttl", LOOP);
+    OSAP_DEBUG(TRACE_TTL_DROP, LOOP, item->vt, item->timeToDeath, ts_readUint16(item->data, 0));
     stackClearSlot(item);
     return;
   }
   // get a ptr for the item, 
   uint16_t ptr = 0;
   if(!findPtr(item->data, &ptr)){    
-    OSAP::error("item at " + item->vt->name + " unable to find ptr, deleting...");
+    OSAP_ERROR(TRACE_NO_PTR, MINOR, item->vt);
     stackClearSlot(item);
     return;
   }
+  OSAP_CAPTURE(CAPTURE_POINT_ITEM, item->vt, item->data, item->len, ptr, PK_READKEY(item->data[ptr + 1]));
   // now the handle-switch, item->data[ptr] = PK_PTR, we switch on instruction which is behind that, 
   switch(PK_READKEY(item->data[ptr + 1])){
     // ------------------------------------------ Terminal / Destination Switches 
@@ -176,7 +186,7 @@ void osapItemHandler(stackItem* item){
       break;
     case PK_PINGRES:
     case PK_SCOPERES:
-      OSAP::error("ping or scope request issued to " + item->vt->name + " not handling those in embedded", MEDIUM);
+      OSAP_ERROR(TRACE_RES_TO_EMBEDDED, MEDIUM, item->vt, PK_READKEY(item->data[ptr + 1]));
       stackClearSlot(item);
       break;
     // ------------------------------------------ Internal Transport 
@@ -191,12 +201,15 @@ void osapItemHandler(stackItem* item){
     case PK_PFWD:
       // port forward...
       if(item->vt->vport == nullptr){
-        OSAP::error("pfwd to non-vport " + item->vt->name, MEDIUM);
+        OSAP_ERROR(TRACE_PFWD_NON_VPORT, MEDIUM, item->vt);
         stackClearSlot(item);
       } else {
         if(item->vt->vport->cts()){
           // walk one step, but only if fn returns true (having success) 
-          if(walkPtr(item->data, item->vt, 1, ptr)) item->vt->vport->send(item->data, item->len);
+          if(walkPtr(item->data, item->vt, 1, ptr)){
+            OSAP_CAPTURE(CAPTURE_POINT_PORT_TX, item->vt, item->data, item->len, ptr + 2, PK_PFWD);
+            item->vt->vport->send(item->data, item->len);
+          }
           stackClearSlot(item);
         } else {
           // failed to send this turn (flow controlled), will return here next round 
@@ -207,29 +220,29 @@ void osapItemHandler(stackItem* item){
     case PK_BBRD:
       // bus forward / bus broadcast: 
       if(item->vt->vbus == nullptr){
-        OSAP::error("bfwd to non-vbus " + item->vt->name, MEDIUM);
+        OSAP_ERROR(TRACE_BFWD_NON_VBUS, MEDIUM, item->vt);
         stackClearSlot(item);
       } else {
         // arg is rxAddr for bus-forwards, is broadcastChannel for bus-broadcast, 
         uint16_t arg = readArg(item->data, ptr + 1);
-        if(item->data[ptr + 1] == PK_BFWD){
-          if(item->vt->vbus->cts(arg)){
+        if(PK_READKEY(item->data[ptr + 1]) == PK_BFWD){
+          if(item->vt->vbus->clearToForward(arg, item->len, false)){
             if(walkPtr(item->data, item->vt, 1, ptr)){
-              item->vt->vbus->send(item->data, item->len, arg);
+              item->vt->vbus->forward(item->data, item->len, arg, false);
             } else {
-              OSAP::error("bfwd fails for bad ptr walk");
+              OSAP_ERROR(TRACE_BFWD_BAD_WALK, MINOR, item->vt, arg);
             }
             stackClearSlot(item);
           } else {
             // failed to bfwd (flow controlled), returning here next round... 
           }
-        } else if (item->data[ptr + 1] == PK_BBRD){
-          if(item->vt->vbus->ctb(arg)){
+        } else if (PK_READKEY(item->data[ptr + 1]) == PK_BBRD){
+          if(item->vt->vbus->clearToForward(arg, item->len, true)){
             if(walkPtr(item->data, item->vt, 1, ptr)){
               // OSAP::debug("broadcasting on ch " + String(arg));
-              item->vt->vbus->broadcast(item->data, item->len, arg);
+              item->vt->vbus->forward(item->data, item->len, arg, true);
             } else {
-              OSAP::error("bbrd fails for bad ptr walk");
+              OSAP_ERROR(TRACE_BBRD_BAD_WALK, MINOR, item->vt, arg);
             }
             stackClearSlot(item);
           } else {
@@ -237,17 +250,17 @@ void osapItemHandler(stackItem* item){
           }
         } else {
           // doesn't make any sense, we switched in on these terms... 
-          OSAP::error("absolute nonsense", MEDIUM);
+          OSAP_ERROR(TRACE_BUS_BAD_KEY, MEDIUM, item->vt, PK_READKEY(item->data[ptr + 1]));
           stackClearSlot(item);
         }
       }
       break;
     case PK_LLESCAPE:
-      OSAP::error("lldebug to embedded, dumping", MINOR);
+      OSAP_ERROR(TRACE_LLESCAPE, MINOR, item->vt);
       stackClearSlot(item);
       break;
     default:
-      OSAP::error("unrecognized ptr to " + item->vt->name + " " + String(PK_READKEY(item->data[ptr + 1])), MINOR);
+      OSAP_ERROR(TRACE_UNKNOWN_PTR, MINOR, item->vt, PK_READKEY(item->data[ptr + 1]));
       stackClearSlot(item);
       // error, delete, 
       break;
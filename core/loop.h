@@ -17,8 +17,8 @@ no warranty is provided, and users accept all liability.
 
 #include "vertex.h"
 
-// we loop, 
-void osapLoop(Vertex* root);
+// we loop, (and say how many items we saw) 
+uint16_t osapLoop(Vertex* root);
 // we handle, 
 void osapItemHandler(stackItem* item);
 
@@ -17,21 +17,56 @@ is; no warranty is provided, and users accept all liability.
 #include "packets.h"
 #include "../utils/cobs.h"
 
-// stash most recents, and counts, and high water mark, 
-uint32_t OSAP::loopItemsHighWaterMark = 0;
-uint32_t errorCount = 0;
-uint32_t debugCount = 0;
+// stash most recents, and counts, and high water mark, (per-thread, like the loop's state) 
+OSAP_THREAD_LOCAL uint32_t OSAP::loopItemsHighWaterMark = 0;
+OSAP_THREAD_LOCAL uint32_t OSAP::traceDrainedAt = 0;
+OSAP_THREAD_LOCAL uint32_t errorCount = 0;
+OSAP_THREAD_LOCAL uint32_t debugCount = 0;
 // strings...
-unsigned char latestError[VT_SLOTSIZE];
-unsigned char latestDebug[VT_SLOTSIZE];
-uint16_t latestErrorLen = 0;
-uint16_t latestDebugLen = 0;
+OSAP_THREAD_LOCAL unsigned char latestError[VT_SLOTSIZE];
+OSAP_THREAD_LOCAL unsigned char latestDebug[VT_SLOTSIZE];
+OSAP_THREAD_LOCAL uint16_t latestErrorLen = 0;
+OSAP_THREAD_LOCAL uint16_t latestDebugLen = 0;
+// when the latest came in thru the trace ring, we hold the record & only write the string if it's asked for 
+OSAP_THREAD_LOCAL traceRecord latestErrorRecord;
+OSAP_THREAD_LOCAL traceRecord latestDebugRecord;
+OSAP_THREAD_LOCAL boolean latestErrorIsRecord = false;
+OSAP_THREAD_LOCAL boolean latestDebugIsRecord = false;
+
+void traceSinkDefault(traceRecord* rec);
+void (*OSAP::traceSink_cb)(traceRecord* rec) = traceSinkDefault;
 
 OSAP::OSAP(String _name) : Vertex("rt_" + _name){};
 
 void OSAP::loop(void){
   // this is the root, so we kick all of the internal net operation from here 
-  osapLoop(this);
+  uint16_t items = osapLoop(this);
+  // then, lowest priority: diagnostics... the sink does i/o, so it only runs on idle passes, 
+  // or once per interval while we're busy, so a burst of traffic isn't slowed by its own trace, 
+  // what doesn't fit in the ring meanwhile is lost & counted 
+  uint32_t now = millis();
+  if(items == 0 || (uint32_t)(now - traceDrainedAt) >= OSAP_TRACE_DRAIN_INTERVAL_MS){
+    traceDrainedAt = now;
+    drainTrace(OSAP_TRACE_DRAIN_PER_LOOP);
+  }
+}
+
+uint16_t OSAP::drainTrace(uint16_t max){
+  traceRecord recs[OSAP_TRACE_DRAIN_PER_LOOP];
+  uint16_t total = 0;
+  while(total < max){
+    uint16_t want = max - total;
+    if(want > OSAP_TRACE_DRAIN_PER_LOOP) want = OSAP_TRACE_DRAIN_PER_LOOP;
+    uint16_t count = traceRead(recs, want);
+    if(traceSink_cb != nullptr){
+      for(uint16_t r = 0; r < count; r ++){
+        traceSink_cb(&(recs[r]));
+      }
+    }
+    total += count;
+    if(count < want) break;
+  }
+  return total;
 }
 
 void OSAP::destHandler(stackItem* item, uint16_t ptr){
@@ -53,8 +88,16 @@ void OSAP::destHandler(stackItem* item, uint16_t ptr){
       ts_writeUint32(debugCount, payload, &wptr);
       // optionally, a string... I know we switch() then if(), it's uggo, 
       if(item->data[ptr + 2] == RT_DBG_ERRMSG){
+        if(latestErrorIsRecord){
+          latestErrorLen = traceFormat(&latestErrorRecord, (char*)latestError, VT_SLOTSIZE);
+          latestErrorIsRecord = false;
+        }
         ts_writeString(latestError, latestErrorLen, payload, &wptr, VT_SLOTSIZE / 2);
       } else if (item->data[ptr + 2] == RT_DBG_DBGMSG){
+        if(latestDebugIsRecord){
+          latestDebugLen = traceFormat(&latestDebugRecord, (char*)latestDebug, VT_SLOTSIZE);
+          latestDebugIsRecord = false;
+        }
         ts_writeString(latestDebug, latestDebugLen, payload, &wptr, VT_SLOTSIZE / 2);
       }
       // that's the payload, I figure, 
@@ -63,18 +106,17 @@ void OSAP::destHandler(stackItem* item, uint16_t ptr){
       stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
       break;
     default:
-      OSAP::error("unrecognized key to root node " + String(item->data[ptr + 2]));
+      OSAP_ERROR(TRACE_ROOT_BAD_KEY, MINOR, this, item->data[ptr + 2]);
       stackClearSlot(item);
       break;
   }
 }
 
-uint8_t errBuf[255];
-uint8_t errBufEncoded[255];
+OSAP_THREAD_LOCAL uint8_t errBuf[255];
+OSAP_THREAD_LOCAL uint8_t errBufEncoded[255];
 
-void debugPrint(String msg){
+void debugPrint(const char* str, uint32_t len){
   // whatever you want,
-  uint32_t len = msg.length();
   // max this long, per the serlink bounds 
   if(len + 9 > 255) len = 255 - 9;
   // header... 
@@ -84,9 +126,9 @@ void debugPrint(String msg){
   errBuf[3] = (len >> 8) & 255;
   errBuf[4] = (len >> 16) & 255;
   errBuf[5] = (len >> 24) & 255;
-  msg.getBytes(&(errBuf[6]), len + 1);
+  memcpy(&(errBuf[6]), str, len);
   // encode from 2, leaving the len, key header... 
-  size_t ecl = cobsEncode(&(errBuf[2]), len + 4, errBufEncoded);
+  size_t ecl = cobsEncodeFast(&(errBuf[2]), len + 4, errBufEncoded);
   // what in god blazes ? copy back from encoded -> previous... 
   memcpy(&(errBuf[2]), errBufEncoded, ecl);
   // set tail to zero, to delineate, 
@@ -95,17 +137,57 @@ void debugPrint(String msg){
   Serial.write(errBuf, errBuf[0]);
 }
 
+void debugPrint(String msg){
+  debugPrint(msg.c_str(), msg.length());
+}
+
 void OSAP::error(String msg, OSAPErrorLevels lvl){
+  (void)lvl;
   //const char* str = msg.c_str();
   msg.getBytes(latestError, VT_SLOTSIZE);
   latestErrorLen = msg.length();
+  latestErrorIsRecord = false;
   errorCount ++;
   debugPrint(msg);
 }
 
 void OSAP::debug(String msg, OSAPDebugStreams stream){
+  (void)stream;
   msg.getBytes(latestDebug, VT_SLOTSIZE);
   latestDebugLen = msg.length();
+  latestDebugIsRecord = false;
   debugCount ++;
   debugPrint(msg);
-}
\ No newline at end of file
+}
+
+// counts & stashes the same as error() / debug(), but only copies a record, 
+void OSAP::trace(uint16_t event, OSAPErrorLevels lvl, Vertex* vt, uint32_t a0, uint32_t a1){
+  uint16_t indice = (vt == nullptr ? 0 : vt->indice);
+  traceWrite(event, lvl, indice, a0, a1);
+  latestErrorRecord.event = event;
+  latestErrorRecord.level = lvl;
+  latestErrorRecord.vtIndice = indice;
+  latestErrorRecord.args[0] = a0;
+  latestErrorRecord.args[1] = a1;
+  latestErrorIsRecord = true;
+  errorCount ++;
+}
+
+void OSAP::trace(uint16_t event, OSAPDebugStreams stream, Vertex* vt, uint32_t a0, uint32_t a1){
+  uint16_t indice = (vt == nullptr ? 0 : vt->indice);
+  traceWrite(event, TRACE_LEVEL_DEBUG | stream, indice, a0, a1);
+  latestDebugRecord.event = event;
+  latestDebugRecord.level = TRACE_LEVEL_DEBUG | stream;
+  latestDebugRecord.vtIndice = indice;
+  latestDebugRecord.args[0] = a0;
+  latestDebugRecord.args[1] = a1;
+  latestDebugIsRecord = true;
+  debugCount ++;
+}
+
+// the sink, by default, ships records out the same way debugPrint() does strings, 
+void traceSinkDefault(traceRecord* rec){
+  char str[64];
+  uint16_t len = traceFormat(rec, str, 64);
+  debugPrint(str, len);
+}
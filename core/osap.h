@@ -16,6 +16,7 @@ is; no warranty is provided, and users accept all liability.
 #define OSAP_H_
 
 #include "vertex.h"
+#include "trace.h"
 
 // largely semantic class, OSAP represents the root vertex in whichever context 
 // and it's where run the main loop from, etc... 
@@ -32,7 +33,29 @@ class OSAP : public Vertex {
     OSAP(String _name);// : Vertex(_name);
     static void error(String msg, OSAPErrorLevels lvl = MINOR );
     static void debug(String msg, OSAPDebugStreams stream = DEFAULT );
-    static uint32_t loopItemsHighWaterMark;
+    // binary versions of the above, for the hot path: no strings, no i/o, just a record in the trace ring, 
+    // which is drained a few at a time into traceSink_cb at the end of idle loops (or every so often, when busy), 
+    static void trace(uint16_t event, OSAPErrorLevels lvl, Vertex* vt, uint32_t a0 = 0, uint32_t a1 = 0);
+    static void trace(uint16_t event, OSAPDebugStreams stream, Vertex* vt, uint32_t a0 = 0, uint32_t a1 = 0);
+    static void (*traceSink_cb)(traceRecord* rec);
+    // hosts w/ their own idle hook / timer can drain from there too, returns how many went out 
+    static uint16_t drainTrace(uint16_t max);
+    static OSAP_THREAD_LOCAL uint32_t traceDrainedAt;
+    static OSAP_THREAD_LOCAL uint32_t loopItemsHighWaterMark;
 };
 
+// diagnostics are meant to go thru these: the level / stream is a constant at each call site, 
+// so filtered-out ones (and their args) compile to nothing 
+// errors this severe and up are kept: HALTING 0, MEDIUM 1, MINOR 2 
+#ifndef OSAP_TRACE_LEVEL
+#define OSAP_TRACE_LEVEL 2 
+#endif 
+// and debug streams w/ their bit set, i.e. (1 << DEFAULT) to drop the LOOP stream 
+#ifndef OSAP_TRACE_STREAMS
+#define OSAP_TRACE_STREAMS 0xff 
+#endif 
+
+#define OSAP_ERROR(event, lvl, vt, ...) do { if((lvl) <= OSAP_TRACE_LEVEL) OSAP::trace(event, lvl, vt, ##__VA_ARGS__); } while(0)
+#define OSAP_DEBUG(event, stream, vt, ...) do { if(OSAP_TRACE_STREAMS & (1 << (stream))) OSAP::trace(event, stream, vt, ##__VA_ARGS__); } while(0)
+
 #endif 
\ No newline at end of file
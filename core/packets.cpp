@@ -56,7 +56,7 @@ boolean walkPtr(uint8_t* pck, Vertex* source, uint8_t steps, uint16_t ptr){
   if(pck[ptr] != PK_PTR){
     // if that fails, bail... 
     if(!findPtr(pck, &ptr)){
-      OSAP::error("before a ptr walk, ptr is out of place...");
+      OSAP_ERROR(TRACE_WALK_NO_PTR, MINOR, source);
       return false;
     }
   }
@@ -101,7 +101,7 @@ boolean walkPtr(uint8_t* pck, Vertex* source, uint8_t steps, uint16_t ptr){
         ptr += 2;
         // though this should only ever be called w/ one step, 
         if(steps != 1){
-          OSAP::error("likely bad call to walkPtr, we have port fwd w/ more than one step");
+          OSAP_ERROR(TRACE_WALK_PFWD_STEPS, MINOR, source, steps);
           return false;
         }
         break;
@@ -112,7 +112,7 @@ boolean walkPtr(uint8_t* pck, Vertex* source, uint8_t steps, uint16_t ptr){
         ptr += 2;
         // this also should only ever be called w/ one step, 
         if(steps != 1){
-          OSAP::error("likely bad call to walkPtr, we have bus fwd w/ more than one step");
+          OSAP_ERROR(TRACE_WALK_BFWD_STEPS, MINOR, source, steps);
           return false; 
         }
         break;
@@ -123,7 +123,7 @@ boolean walkPtr(uint8_t* pck, Vertex* source, uint8_t steps, uint16_t ptr){
         ptr += 2;
         break;
       default:
-        OSAP::error("have out of place keys in the ptr walk...");
+        OSAP_ERROR(TRACE_WALK_BAD_KEY, MINOR, source, PK_READKEY(pck[ptr + 1]));
         return false;
     }
   } // end steps, alleged success,  
@@ -134,12 +134,14 @@ uint16_t writeDatagram(uint8_t* gram, uint16_t maxGramLength, Route* route, uint
   uint16_t wptr = 0;
   ts_writeUint16(route->ttl, gram, &wptr);
   ts_writeUint16(route->segSize, gram, &wptr);
-  memcpy(&(gram[wptr]), route->path, route->pathLen);
-  wptr += route->pathLen;
-  if(wptr + payloadLen > route->segSize){
-    OSAP::error("writeDatagram asked to write packet that exceeds segSize, bailing", MEDIUM);
+  // it's the minimum of the route's segsize & the space we're writing into, 
+  maxGramLength = min(maxGramLength, route->segSize);
+  if(wptr + route->pathLen + payloadLen > maxGramLength){
+    OSAP_ERROR(TRACE_DATAGRAM_OVERSIZE, MEDIUM, nullptr, wptr + route->pathLen + payloadLen, maxGramLength);
     return 0;
   }
+  memcpy(&(gram[wptr]), route->path, route->pathLen);
+  wptr += route->pathLen;
   memcpy(&(gram[wptr]), payload, payloadLen);
   wptr += payloadLen;
   return wptr;
@@ -147,22 +149,29 @@ uint16_t writeDatagram(uint8_t* gram, uint16_t maxGramLength, Route* route, uint
 
 // original gram, payload, len, 
 uint16_t writeReply(uint8_t* ogGram, uint8_t* gram, uint16_t maxGramLength, uint8_t* payload, uint16_t payloadLen){
+  return writeReply(ogGram, gram, maxGramLength, payload, payloadLen, nullptr, 0);
+}
+
+// as above, w/ the payload in two parts: i.e. a small header & a body that lives elsewhere, 
+// so callers needn't stage the body into the payload buffer first, 
+uint16_t writeReply(uint8_t* ogGram, uint8_t* gram, uint16_t maxGramLength, uint8_t* payload, uint16_t payloadLen, uint8_t* body, uint16_t bodyLen){
   // 1st up, we can straight copy the 1st 4 bytes, 
   memcpy(gram, ogGram, 4);
   // now find a ptr, 
   uint16_t ptr = 0;
   if(!findPtr(ogGram, &ptr)){
-    OSAP::error("writeReply can't find the pointer...", MEDIUM);
+    OSAP_ERROR(TRACE_REPLY_NO_PTR, MEDIUM, nullptr);
     return 0;
   }
   // do we have enough space? it's the minimum of the allowed segsize & stated maxGramLength, 
   maxGramLength = min(maxGramLength, ts_readUint16(ogGram, 2));
-  if(ptr + 1 + payloadLen > maxGramLength){
-    OSAP::error("writeReply asked to write packet that exceeds maxGramLength, bailing", MEDIUM);
+  if(ptr + 1 + payloadLen + bodyLen > maxGramLength){
+    OSAP_ERROR(TRACE_REPLY_OVERSIZE, MEDIUM, nullptr, ptr + 1 + payloadLen + bodyLen, maxGramLength);
     return 0;
   }
   // write the payload in, apres-pointer, 
   memcpy(&(gram[ptr + 1]), payload, payloadLen);
+  if(bodyLen) memcpy(&(gram[ptr + 1 + payloadLen]), body, bodyLen);
   // now we can do a little reversing... 
   uint16_t wptr = 4;
   uint16_t end = ptr;
@@ -184,10 +193,10 @@ uint16_t writeReply(uint8_t* ogGram, uint8_t* gram, uint16_t maxGramLength, uint
         gram[wptr ++] = ogGram[rptr + 1];
         break;
       default:
-        OSAP::error("writeReply fails to reverse this packet, bailing", MEDIUM);
+        OSAP_ERROR(TRACE_REPLY_BAD_KEY, MEDIUM, nullptr, PK_READKEY(ogGram[rptr]));
         return 0;
     }
   } // end thru-loop, 
   // it's written, return the len  // we had gram[ptr] = PK_PTR, so len was ptr + 1, then added payloadLen, 
-  return end + 1 + payloadLen;
+  return end + 1 + payloadLen + bodyLen;
 }
\ No newline at end of file
@@ -44,5 +44,6 @@ boolean findPtr(uint8_t* pck, uint16_t* ptr);
 boolean walkPtr(uint8_t* pck, Vertex* vt, uint8_t steps, uint16_t ptr = 4);
 uint16_t writeDatagram(uint8_t* gram, uint16_t maxGramLength, Route* route, uint8_t* payload, uint16_t payloadLen);
 uint16_t writeReply(uint8_t* ogGram, uint8_t* gram, uint16_t maxGramLength, uint8_t* payload, uint16_t payloadLen);
+uint16_t writeReply(uint8_t* ogGram, uint8_t* gram, uint16_t maxGramLength, uint8_t* payload, uint16_t payloadLen, uint8_t* body, uint16_t bodyLen);
 
 #endif 
\ No newline at end of file
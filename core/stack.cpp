@@ -66,11 +66,61 @@ void stackLoadSlot(Vertex* vt, uint8_t od, uint8_t* data, uint16_t len){
   memcpy(vt->firstFree[od]->data, data, len);
   vt->firstFree[od]->len = len;
   vt->firstFree[od]->arrivalTime = millis();
+  if(od == VT_STACK_DESTINATION && vt->vbus != nullptr) vt->vbus->queueLoaded(vt->firstFree[od]);
   //DEBUG("load " + String(vt->firstFree[od]->indice) + " " + String(vt->firstFree[od]->arrivalTime));
   // now firstFree is next, 
   vt->firstFree[od] = vt->firstFree[od]->next;
 }
 
+// hands out the slot stackLoadSlot would have copied into, so callers can write straight into it, 
+stackItem* stackReserveSlot(Vertex* vt, uint8_t od){
+  if(!stackEmptySlot(vt, od)) return nullptr;
+  return vt->firstFree[od];
+}
+
+// the next maxItems-or-fewer slots that would be loaded in turn, 
+uint8_t stackReserveSlots(Vertex* vt, uint8_t od, stackItem** items, uint8_t maxItems){
+  if(od > 1) return 0;
+  uint8_t count = 0;
+  stackItem* item = vt->firstFree[od];
+  // same test as stackEmptySlot, walked forwards 
+  while(count < maxItems && item->next->len == 0 && item->next != vt->firstFree[od]){
+    items[count ++] = item;
+    item = item->next;
+  }
+  return count;
+}
+
+// and ingests it, as stackLoadSlot does after its copy, 
+void stackCommitSlot(stackItem* item, uint16_t len){
+  Vertex* vt = item->vt;
+  uint8_t od = item->od;
+  if(vt->firstFree[od] != item){
+    // an item cleared from mid-queue while this was reserved is re-linked as firstFree, ahead of us... 
+    // we're still empty (& so, in the free part of the ring), so we can just move up into its spot 
+    if(item->len != 0){
+      OSAP_ERROR(TRACE_COMMIT_NOT_RESERVED, MEDIUM, vt, item->indice);
+      return;
+    }
+    stackItem* ff = vt->firstFree[od];
+    // if the queue's empty it starts at firstFree, which is now us, 
+    if(vt->queueStart[od] == ff) vt->queueStart[od] = item;
+    // pull from chain, 
+    item->previous->next = item->next;
+    item->next->previous = item->previous;
+    // and insert just before old firstFree, 
+    ff->previous->next = item;
+    item->previous = ff->previous;
+    item->next = ff;
+    ff->previous = item;
+    vt->firstFree[od] = item;
+  }
+  item->len = len;
+  item->arrivalTime = millis();
+  if(od == VT_STACK_DESTINATION && vt->vbus != nullptr) vt->vbus->queueLoaded(item);
+  vt->firstFree[od] = item->next;
+}
+
 // -------------------------------------------------------- EXIT SIDE 
 // return count of items occupying stack, and list of ptrs to them, 
 uint8_t stackGetItems(Vertex* vt, uint8_t od, stackItem** items, uint8_t maxItems){
@@ -96,11 +146,14 @@ uint8_t stackGetItems(Vertex* vt, uint8_t od, stackItem** items, uint8_t maxItem
 void stackClearSlot(Vertex* vt, uint8_t od, stackItem* item){
   // this would be deadly, so:
   if(od > 1) {
-    OSAP::error("stackClearSlot, od > 1, badness", MEDIUM);
+    OSAP_ERROR(TRACE_CLEAR_BAD_OD, MEDIUM, vt, od);
     return;
   }
+  // bus drops' queue counts, 
+  if(od == VT_STACK_DESTINATION && vt->vbus != nullptr) vt->vbus->queueCleared(item);
   // item is 0-len, etc 
   item->len = 0;
+  item->borrowed = false;
   // is this
   uint8_t indice = item->indice;
   // if was queueStart, queueStart now at next,
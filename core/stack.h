@@ -34,6 +34,7 @@ typedef struct stackItem {
   uint8_t od;                         // origin / destination to which we belong, 
   uint8_t indice;                     // actual physical position in the stack 
   uint16_t ptr = 0;                   // current data[ptr] == 88 
+  boolean borrowed = false;           // on loan to the vertex (zero-copy rx), loop skips these 
   stackItem* next = nullptr;          // linked ringbuffer next 
   stackItem* previous = nullptr;      // linked ringbuffer previous 
 } stackItem;
@@ -44,6 +45,11 @@ void stackReset(Vertex* vt);
 // stack origin side 
 boolean stackEmptySlot(Vertex* vt, uint8_t od);
 void stackLoadSlot(Vertex* vt, uint8_t od, uint8_t* data, uint16_t len);
+// or, write in-place: reserve the next free slot (nullptr if full), fill item->data, then commit 
+stackItem* stackReserveSlot(Vertex* vt, uint8_t od);
+void stackCommitSlot(stackItem* item, uint16_t len);
+// or a run of them, for batched rx: commit them in the order they're handed out 
+uint8_t stackReserveSlots(Vertex* vt, uint8_t od, stackItem** items, uint8_t maxItems);
 
 // stack exit side 
 uint8_t stackGetItems(Vertex* vt, uint8_t od, stackItem** items, uint8_t maxItems);
@@ -0,0 +1,132 @@
+/*
+osap/trace.cpp
+
+binary trace ring, for diagnostics that don't stall the loop 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "trace.h"
+#include <stdio.h>
+
+static_assert((OSAP_TRACE_RING_SIZE & (OSAP_TRACE_RING_SIZE - 1)) == 0, "OSAP_TRACE_RING_SIZE should be a power of two");
+
+// per-thread (on hosts) like the rest of the loop's state, 
+OSAP_THREAD_LOCAL traceRecord traceRing[OSAP_TRACE_RING_SIZE];
+OSAP_THREAD_LOCAL uint32_t traceHead = 0;
+OSAP_THREAD_LOCAL uint32_t traceTail = 0;
+OSAP_THREAD_LOCAL uint32_t traceLost = 0;
+
+// claims the next index, 
+static inline uint32_t traceReserve(void){
+#if defined(__ARM_ARCH_6M__)
+  // no ldrex / strex on m0, so: a very short critical section 
+  uint32_t primask;
+  __asm volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+  uint32_t index = traceHead ++;
+  __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+  return index;
+#else 
+  return __atomic_fetch_add(&traceHead, 1, __ATOMIC_RELAXED);
+#endif 
+}
+
+void traceWrite(uint16_t event, uint8_t level, uint16_t vtIndice, uint32_t a0, uint32_t a1){
+  uint32_t index = traceReserve();
+  traceRecord* rec = &(traceRing[index & (OSAP_TRACE_RING_SIZE - 1)]);
+  // invalidate, fill, then publish, 
+  __atomic_store_n(&(rec->seq), 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  rec->time = micros();
+  rec->event = event;
+  rec->vtIndice = vtIndice;
+  rec->level = level;
+  rec->args[0] = a0;
+  rec->args[1] = a1;
+  __atomic_store_n(&(rec->seq), index + 1, __ATOMIC_RELEASE);
+}
+
+uint16_t traceRead(traceRecord* out, uint16_t max){
+  uint16_t count = 0;
+  while(count < max){
+    // if we've been lapped, skip to the oldest record that's still there, 
+    uint32_t head = __atomic_load_n(&traceHead, __ATOMIC_ACQUIRE);
+    if(head - traceTail > OSAP_TRACE_RING_SIZE){
+      traceLost += head - traceTail - OSAP_TRACE_RING_SIZE;
+      traceTail = head - OSAP_TRACE_RING_SIZE;
+    }
+    if(traceTail == head) break;
+    traceRecord* rec = &(traceRing[traceTail & (OSAP_TRACE_RING_SIZE - 1)]);
+    uint32_t seq = __atomic_load_n(&(rec->seq), __ATOMIC_ACQUIRE);
+    // still being written (or not yet started on): try again next time, 
+    if(seq == 0 || (int32_t)(seq - (traceTail + 1)) < 0) break;
+    // overwritten since we checked head, go 'round again 
+    if(seq != traceTail + 1) continue;
+    memcpy(&(out[count]), rec, sizeof(traceRecord));
+    // and if it changed while we copied, it's torn: same deal 
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&(rec->seq), __ATOMIC_RELAXED) != seq) continue;
+    traceTail ++;
+    count ++;
+  }
+  return count;
+}
+
+uint32_t traceDropped(void){
+  return traceLost;
+}
+
+#if OSAP_TRACE_FORMATS
+#define OSAP_TRACE_FORMAT(id, format) format,
+const char* const traceFormats[TRACE_NUM_EVENTS] = {
+  OSAP_TRACE_EVENTS(OSAP_TRACE_FORMAT)
+};
+#undef OSAP_TRACE_FORMAT
+#endif 
+
+uint16_t traceFormat(const traceRecord* rec, char* buf, uint16_t maxLen){
+  if(maxLen == 0) return 0;
+  int len = snprintf(buf, maxLen, "%s %u at vt %u: ", 
+    (rec->level & TRACE_LEVEL_DEBUG) ? "dbg" : "err", (unsigned)rec->event, (unsigned)rec->vtIndice
+  );
+  if(len < 0) return 0;
+  // header alone filled it (snprintf has terminated it), so there's no room for the rest 
+  if(len >= maxLen - 1) return maxLen - 1;
+#if OSAP_TRACE_FORMATS
+  // render the format, one arg per conversion, 
+  if(rec->event < TRACE_NUM_EVENTS){
+    const char* f = traceFormats[rec->event];
+    uint8_t a = 0;
+    while(*f != 0 && len < maxLen - 1){
+      if(f[0] == '%' && f[1] != 0 && a < 2){
+        uint32_t arg = rec->args[a ++];
+        float fval;
+        int n = 0;
+        switch(f[1]){
+          case 'i': n = snprintf(&(buf[len]), maxLen - len, "%ld", (long)(int32_t)arg); break;
+          case 'x': n = snprintf(&(buf[len]), maxLen - len, "0x%lx", (unsigned long)arg); break;
+          case 'f': memcpy(&fval, &arg, 4); n = snprintf(&(buf[len]), maxLen - len, "%g", (double)fval); break;
+          default: n = snprintf(&(buf[len]), maxLen - len, "%lu", (unsigned long)arg); break;
+        }
+        if(n < 0) break;
+        len += n;
+        f += 2;
+      } else {
+        buf[len ++] = *f ++;
+      }
+    }
+    if(len >= maxLen) len = maxLen - 1;
+    buf[len] = 0;
+    return len;
+  }
+#endif 
+  int n = snprintf(&(buf[len]), maxLen - len, "%lu %lu", (unsigned long)rec->args[0], (unsigned long)rec->args[1]);
+  if(n > 0) len += n;
+  return (len >= maxLen ? maxLen - 1 : len);
+}
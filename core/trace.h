@@ -0,0 +1,142 @@
+/*
+osap/trace.h
+
+binary trace ring, for diagnostics that don't stall the loop 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "vertex.h"
+
+// records in the ring, a power of two... when writers lap the sink, the oldest are lost (and counted) 
+#ifndef OSAP_TRACE_RING_SIZE
+#define OSAP_TRACE_RING_SIZE 32 
+#endif 
+
+// records the sink drains per idle OSAP::loop(), 
+#ifndef OSAP_TRACE_DRAIN_PER_LOOP
+#define OSAP_TRACE_DRAIN_PER_LOOP 4 
+#endif 
+
+// and while the loop is busy, it drains at most this often (ms) 
+#ifndef OSAP_TRACE_DRAIN_INTERVAL_MS
+#define OSAP_TRACE_DRAIN_INTERVAL_MS 10 
+#endif 
+
+// every diagnostic, registered here at compile time as X(id, format): records carry only the id & two args, 
+// and the format (%i int32, %u uint32, %x hex, %f a float's bits, see traceFloat()) is how hosts decode 'em... 
+// add new ones at the end, so that ids stay put 
+#define OSAP_TRACE_EVENTS(X) \
+  X(TRACE_NONE, "") \
+  X(TRACE_TTL_DROP, "item times out w/ %i ms to live, of %u ttl") \
+  X(TRACE_NO_PTR, "item unable to find ptr, deleting") \
+  X(TRACE_SIB_NO_PARENT, "no parent during sib transport") \
+  X(TRACE_SIB_NO_SIBLING, "no sibling %u during sib transport") \
+  X(TRACE_PARENT_NO_PARENT, "no parent during parent transport") \
+  X(TRACE_CHILD_NO_CHILD, "no child %u during child transport") \
+  X(TRACE_TRANSPORT_BAD_KEY, "internal transport failure, ptr walk ends at unknown key %u") \
+  X(TRACE_LOOP_OVERFULL, "loop items %u exceeds %u, breaking per-loop transport properties... pls fix") \
+  X(TRACE_RES_TO_EMBEDDED, "ping or scope response (key %u) issued to embedded, not handling those") \
+  X(TRACE_PFWD_NON_VPORT, "pfwd to non-vport") \
+  X(TRACE_BFWD_NON_VBUS, "bfwd to non-vbus") \
+  X(TRACE_BFWD_BAD_WALK, "bfwd to rxAddr %u fails for bad ptr walk") \
+  X(TRACE_BBRD_BAD_WALK, "bbrd on ch %u fails for bad ptr walk") \
+  X(TRACE_BUS_BAD_KEY, "bus forward w/ nonsense key %u") \
+  X(TRACE_LLESCAPE, "lldebug to embedded, dumping") \
+  X(TRACE_UNKNOWN_PTR, "unrecognized ptr key %u") \
+  X(TRACE_WALK_NO_PTR, "before a ptr walk, ptr is out of place") \
+  X(TRACE_WALK_PFWD_STEPS, "likely bad call to walkPtr, port fwd w/ %u steps") \
+  X(TRACE_WALK_BFWD_STEPS, "likely bad call to walkPtr, bus fwd w/ %u steps") \
+  X(TRACE_WALK_BAD_KEY, "out of place key %u in the ptr walk") \
+  X(TRACE_DATAGRAM_OVERSIZE, "writeDatagram of %u bytes exceeds segSize %u, bailing") \
+  X(TRACE_REPLY_NO_PTR, "writeReply can't find the pointer") \
+  X(TRACE_REPLY_OVERSIZE, "writeReply of %u bytes exceeds maxGramLength %u, bailing") \
+  X(TRACE_REPLY_BAD_KEY, "writeReply fails to reverse key %u, bailing") \
+  X(TRACE_COMMIT_NOT_RESERVED, "stackCommitSlot on slot %u, which isn't the reserved one") \
+  X(TRACE_CLEAR_BAD_OD, "stackClearSlot w/ od %u") \
+  X(TRACE_ROOT_BAD_KEY, "unrecognized key %u to root node") \
+  X(TRACE_MAXCHILDREN, "can't nest a vertex under this one, it has VT_MAXCHILDREN (%u)") \
+  X(TRACE_GENERIC_DEST, "generic destHandler") \
+  X(TRACE_AGG_OVERSIZE, "datagram of %u won't fit in agg mtu %u") \
+  X(TRACE_AGG_MALFORMED, "malformed aggregate frame, %u bytes") \
+  X(TRACE_AGG_RX_FULL, "aggregate rx drops for full stack") \
+  X(TRACE_AGG_BAD_KEY, "aggregate frame w/ unknown key %u") \
+  X(TRACE_AGG_NOT_OURS, "aggregate for drop %u rx'd at drop %u") \
+  X(TRACE_BRD_NO_PTR, "can't find ptr during broadcast injest on ch %u") \
+  X(TRACE_BRD_OVERSIZE, "datagram + channel route is too large, %u bytes") \
+  X(TRACE_BRD_RX_FULL, "broadcast injest on ch %u drops for full stack") \
+  X(TRACE_BRD_BATCH_FULL, "broadcast batch drops %u for full stack") \
+  X(TRACE_BRD_CH_OOB, "attempt to write to oob broadcast channel %u") \
+  X(TRACE_BRD_CH_OVERWRITE, "overwriting previous broadcast ch %u") \
+  X(TRACE_VBUS_BAD_KEY, "vbus rx msg w/ unrecognized vbus key %u, bailing") \
+  X(TRACE_EP_ROUTES_OOB, "route add is oob, have %u") \
+  X(TRACE_EP_RELEASE_BAD, "release() w/ a handle we aren't holding") \
+  X(TRACE_EP_RELEASE_NO_PTR, "released slot has no ptr, deleting") \
+  X(TRACE_EP_BORROW_NO_RETAIN, "borrowed delta frame can't be retained, taking it as consumed") \
+  X(TRACE_EP_TX_OVERSIZE, "attempting to write oversized datagram, %u bytes on route %u") \
+  X(TRACE_EP_DELTA_NO_BASE, "dropping delta frame w/ unknown base %u") \
+  X(TRACE_EP_ROUTE_ADD, "adding route w/ ttl %u, segSize %u") \
+  X(TRACE_EP_BAD_KEY, "endpoint rx msg w/ unrecognized endpoint key %u, bailing") \
+  X(TRACE_TYPED_BAD_LEN, "typed endpoint rx'd %u bytes, wants %u") \
+  X(TRACE_SIM_OVER_MTU, "sim link drops %u byte frame, over mtu %u") \
+  X(TRACE_SIM_ATTACH, "sim vbus can't attach at rxAddr %u") 
+
+#define OSAP_TRACE_ENUM(id, format) id,
+enum OSAPTraceEvents {
+  OSAP_TRACE_EVENTS(OSAP_TRACE_ENUM)
+  TRACE_NUM_EVENTS
+};
+#undef OSAP_TRACE_ENUM
+
+// the formats only take up space where they're decoded: on by default on hosts, 
+// mcu builds just ship ids (and hosts w/ this table do the rest) 
+#ifndef OSAP_TRACE_FORMATS
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+#define OSAP_TRACE_FORMATS 1 
+#else 
+#define OSAP_TRACE_FORMATS 0 
+#endif 
+#endif 
+
+#if OSAP_TRACE_FORMATS
+extern const char* const traceFormats[TRACE_NUM_EVENTS];
+#endif 
+
+// float args go in by their bits, 
+static inline uint32_t traceFloat(float val){
+  uint32_t bits;
+  memcpy(&bits, &val, 4);
+  return bits;
+}
+
+// level is an OSAPErrorLevels for errors, or TRACE_LEVEL_DEBUG | an OSAPDebugStreams 
+#define TRACE_LEVEL_DEBUG 0x80 
+
+typedef struct traceRecord {
+  uint32_t seq;               // index + 1 once written, 0 while being written 
+  uint32_t time;              // micros() 
+  uint16_t event;
+  uint16_t vtIndice;
+  uint8_t level;
+  uint32_t args[2];
+} traceRecord;
+
+// lock-free for any # of writers (the loop, isrs), one reader (the sink)
+void traceWrite(uint16_t event, uint8_t level, uint16_t vtIndice, uint32_t a0, uint32_t a1);
+// copies out up to max records in order, returns # copied 
+uint16_t traceRead(traceRecord* out, uint16_t max);
+// records lost to overwrites, 
+uint32_t traceDropped(void);
+// a short human-readable version (w/ the event's format, if we have the table), returns its length 
+uint16_t traceFormat(const traceRecord* rec, char* buf, uint16_t maxLen);
+
+#endif 
@@ -32,8 +32,11 @@ no warranty is provided, and users accept all liability.
 // -------------------------------------------------------- Endpoint Keys 
 
 #define EP_SS_ACK 101       // the ack 
+#define EP_SS_ACK_WIDE 102  // the ack, w/ a 16-bit id 
 #define EP_SS_ACKLESS 121   // single segment, no ack 
 #define EP_SS_ACKED 122     // single segment, request ack 
+#define EP_SS_DELTA 123     // single segment, delta against the last acked frame, request ack 
+#define EP_SS_ACKED_WIDE 124 // single segment, request ack w/ a 16-bit id 
 #define EP_QUERY 131        // query request 
 #define EP_QUERY_RESP 132   // reply to query request 
 #define EP_ROUTE_QUERY_REQ 141 
@@ -42,9 +45,38 @@ no warranty is provided, and users accept all liability.
 #define EP_ROUTE_SET_RES 144 
 #define EP_ROUTE_RM_REQ 147
 #define EP_ROUTE_RM_RES 148 
+#define EP_ROUTE_STAT_REQ 149 
+#define EP_ROUTE_STAT_RES 150 
+// rate requests are <id>, <route u16>, <rateDatagrams u32>, <rateBytes u32>, <burstDatagrams u16>, <burstBytes u32> 
+#define EP_ROUTE_RATE_REQ 151 
+#define EP_ROUTE_RATE_RES 152 
 
 #define EP_ROUTEMODE_ACKED 167
 #define EP_ROUTEMODE_ACKLESS 168 
+#define EP_ROUTEMODE_ACKED_DELTA 169 
+#define EP_ROUTEMODE_ACKED_WIDE 170 
+
+// -------------------------------------------------------- Scope Keys 
+
+// scope requests are <PK_SCOPEREQ>, <id>, <timeTag u32>, and optionally <mode>, <startOrdinal u16>, <sinceVersion u32> 
+#define SCOPE_MODE_SELF 0         // just the target, as ever 
+#define SCOPE_MODE_SUBTREE 1      // the target and its descendants, depth-first, target is ordinal 0 
+#define SCOPE_MODE_SIBLINGS 2     // the target's parent's children, ordinal == indice 
+#define SCOPE_MODE_MASK 0x7F 
+// or'd into the mode, w/ a sinceVersion: only scope if the target's topoVersion has moved past it, 
+// (for SCOPE_MODE_SIBLINGS, the target's parent's version, or the target's own if it's the root) 
+#define SCOPE_IF_NEWER 0x80 
+// otherwise the reply is just <PK_SCOPERES>, <id>, <prevTimeTag u32>, SCOPE_NOT_MODIFIED, <topoVersion u32> 
+// (versions restart from zero when a device resets, so a mapper that loses its link should re-sweep unconditionally)
+#define SCOPE_NOT_MODIFIED 92 
+// single replies carry the vertex' <topoVersion u32> after its name, 
+// batched replies put this where the vertex type would be, then: <mode>, <firstOrdinal u16>, <count>, <flags>, 
+// & count records of <prevTimeTag u32>, <type>, <link state>, <indice u16>, <numSiblings u16>, <numChildren u16>, 
+// <topoVersion u32>, <name> 
+// where a vbus' link state is <addrSpaceSize u16>, <ownRxAddr u16>, <mapLen u8>, <map> 
+#define SCOPE_BATCH_RES 91 
+#define SCOPE_BATCH_END 1         // flag: this packet has the last record 
+#define SCOPE_BATCH_STALLED 2     // flag: we ran out of stack, ask again from firstOrdinal + count 
 
 // -------------------------------------------------------- Root Keys 
 
@@ -63,6 +95,21 @@ no warranty is provided, and users accept all liability.
 #define VBUS_BROADCAST_SET_RES 144 
 #define VBUS_BROADCAST_RM_REQ 147 
 #define VBUS_BROADCAST_RM_RES 148 
+#define VBUS_LINKSTATE_REQ 149 
+#define VBUS_LINKSTATE_RES 150 
+#define VBUS_LINKSTATE_DELTA_REQ 151 
+#define VBUS_LINKSTATE_DELTA_RES 152 
+#define VBUS_BROADCAST_SUB_ADD_REQ 153 
+#define VBUS_BROADCAST_SUB_ADD_RES 154 
+#define VBUS_BROADCAST_SUB_QUERY_REQ 155 
+#define VBUS_BROADCAST_SUB_QUERY_RES 156 
+#define VBUS_BROADCAST_SUB_RM_REQ 157 
+#define VBUS_BROADCAST_SUB_RM_RES 158 
+
+// -------------------------------------------------------- VBus Link Keys (frame headers, when aggregating)
+
+#define VBUS_AGG_UNICAST 181      // <key>, <rxAddr u16>, then <len u16, datagram> * n 
+#define VBUS_AGG_BROADCAST 182    // <key>, <channel u16>, then likewise 
 
 // -------------------------------------------------------- BUS ACTION KEYS (outside OSAP scope)
 
@@ -16,11 +16,12 @@ no warranty is provided, and users accept all liability.
 #include "stack.h"
 #include "osap.h"
 #include "packets.h"
+#include "capture.h"
 
 // ---------------------------------------------- Temporary Stash 
 
-uint8_t Vertex::payload[VT_SLOTSIZE];
-uint8_t Vertex::datagram[VT_SLOTSIZE];
+OSAP_THREAD_LOCAL uint8_t Vertex::payload[VT_SLOTSIZE];
+OSAP_THREAD_LOCAL uint8_t Vertex::datagram[VT_SLOTSIZE];
 
 // ---------------------------------------------- Vertex Constructor and Defaults 
 
@@ -43,11 +44,12 @@ Vertex::Vertex(
     indice = 0;
   } else {
     if (_parent->numChildren >= VT_MAXCHILDREN) {
-      OSAP::error("trying to nest a vertex under " + _parent->name + " but we have reached VT_MAXCHILDREN limit", HALTING);
+      OSAP_ERROR(TRACE_MAXCHILDREN, HALTING, _parent, VT_MAXCHILDREN);
     } else {
       this->indice = _parent->numChildren;
       this->parent = _parent;
       _parent->children[_parent->numChildren ++] = this;
+      _parent->bumpTopology();
     }
   }
 }
@@ -56,9 +58,15 @@ void Vertex::loop(void){
   if(loop_cb != nullptr) return loop_cb(this);
 }
 
+// a change here is a change to everything above us, 
+void Vertex::bumpTopology(void){
+  for(Vertex* vt = this; vt != nullptr; vt = vt->parent) vt->topoVersion ++;
+}
+
 void Vertex::destHandler(stackItem* item, uint16_t ptr){
   // generic handler...
-  OSAP::debug("generic destHandler at " + name);
+  (void)ptr;
+  OSAP_DEBUG(TRACE_GENERIC_DEST, DEFAULT, this);
   stackClearSlot(item);
 }
 
@@ -75,6 +83,35 @@ void Vertex::pingRequestHandler(stackItem* item, uint16_t ptr){
 }
 
 void Vertex::scopeRequestHandler(stackItem* item, uint16_t ptr){
+  uint8_t mode = (item->len > ptr + 7 ? item->data[ptr + 7] : SCOPE_MODE_SELF);
+  // conditional requests get a not-modified if nothing here (or below) has changed since the mapper last looked, 
+  // a sibling sweep covers our parent's children, so it's the parent's version (which moves w/ any of theirs) that counts 
+  if((mode & SCOPE_IF_NEWER) && item->len >= ptr + 14){
+    Vertex* versioned = ((mode & SCOPE_MODE_MASK) == SCOPE_MODE_SIBLINGS && parent != nullptr ? parent : this);
+    uint32_t version = versioned->topoVersion;
+    uint16_t rptr = ptr + 10;
+    uint32_t since = ts_readUint32(item->data, &rptr);
+    // wrap-safe 'version <= since' 
+    if((int32_t)(version - since) <= 0){
+      uint16_t wptr = 0;
+      payload[wptr ++] = PK_SCOPERES;
+      payload[wptr ++] = item->data[ptr + 2];
+      ts_writeUint32(scopeTimeTag, payload, &wptr);
+      rptr = ptr + 3;
+      ts_readUint32(&scopeTimeTag, item->data, &rptr);
+      payload[wptr ++] = SCOPE_NOT_MODIFIED;
+      ts_writeUint32(version, payload, &wptr);
+      uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+      stackClearSlot(item);
+      stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+      return;
+    }
+  }
+  // requests w/ a mode past the time tag want a batch, 
+  if((mode & SCOPE_MODE_MASK) != SCOPE_MODE_SELF){
+    scopeBatchHandler(item, ptr);
+    return;
+  }
   // key & id, 
   payload[0] = PK_SCOPERES;
   payload[1] = item->data[ptr + 2];
@@ -91,23 +128,16 @@ void Vertex::scopeRequestHandler(stackItem* item, uint16_t ptr){
   if(type == VT_TYPE_VPORT){
     payload[wptr ++] = (vport->isOpen() ? 1 : 0);
   } else if (type == VT_TYPE_VBUS){
-    uint16_t addrSize = vbus->addrSpaceSize;
-    uint16_t addr = 0;
     // ok we write the address size in first, then our own rxaddr, 
     ts_writeUint16(vbus->addrSpaceSize, payload, &wptr);
     ts_writeUint16(vbus->ownRxAddr, payload, &wptr);
-    // then *so long a we're not overwriting*, we stuff link-state bytes, 
-    while(wptr + 8 + name.length() <= VT_SLOTSIZE){
-      payload[wptr] = 0;
-      for(uint8_t b = 0; b < 8; b ++){
-        payload[wptr] |= (vbus->isOpen(addr) ? 1 : 0) << b;
-        addr ++;
-        if(addr >= addrSize) goto end;
-      }
-      wptr ++;
+    // then as much of the link-state map as fits, leaving room for the tail (indices, name) 
+    // & for the reply's route, which is as long as the request's up-to its ptr, 
+    uint16_t maxLen = min((uint16_t)VT_SLOTSIZE, ts_readUint16(item->data, 2));
+    uint16_t tail = ptr + 1 + 6 + 4 + name.length() + 4;
+    if(wptr + tail < maxLen){
+      wptr += vbus->writeLinkState(&(payload[wptr]), maxLen - tail - wptr);
     }
-    end:
-    wptr ++; // += 1 more, so we write into next, 
   }
   // our own indice, # siblings, and # children, 
   ts_writeUint16(indice, payload, &wptr);
@@ -117,14 +147,138 @@ void Vertex::scopeRequestHandler(stackItem* item, uint16_t ptr){
     ts_writeUint16(0, payload, &wptr);
   }
   ts_writeUint16(numChildren, payload, &wptr);
-  // finally, our string name:
+  // our string name:
   ts_writeString(name, payload, &wptr);
+  // and the topology version, which older mappers will just ignore 
+  ts_writeUint32(topoVersion, payload, &wptr);
   // and roll that back up, rm old, and ship it, 
   uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
   stackClearSlot(item);
   stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
 }
 
+// one batch record for this vertex, or 0 if it won't fit in maxLen... when squeeze is set (it's the 1st record 
+// in a packet), we'd rather truncate the link-state map & then the name than not write it at all 
+uint16_t Vertex::writeScopeRecord(uint8_t* buf, uint16_t maxLen, uint32_t timeTag, boolean squeeze){
+  uint16_t nameLen = name.length();
+  uint16_t mapLen = 0;
+  uint16_t size = 4 + 1 + 6 + 4 + 4 + nameLen;
+  if(type == VT_TYPE_VPORT){
+    size += 1;
+  } else if (type == VT_TYPE_VBUS){
+    mapLen = min((vbus->addrSpaceSize + 7) / 8, 255);
+    size += 5 + mapLen;
+  }
+  if(size > maxLen){
+    if(!squeeze) return 0;
+    uint16_t over = size - maxLen;
+    uint16_t cut = min(over, mapLen);
+    mapLen -= cut;
+    over -= cut;
+    if(over > nameLen) return 0;
+    nameLen -= over;
+  }
+  uint16_t wptr = 0;
+  ts_writeUint32(scopeTimeTag, buf, &wptr);
+  scopeTimeTag = timeTag;
+  buf[wptr ++] = type;
+  if(type == VT_TYPE_VPORT){
+    buf[wptr ++] = (vport->isOpen() ? 1 : 0);
+  } else if (type == VT_TYPE_VBUS){
+    ts_writeUint16(vbus->addrSpaceSize, buf, &wptr);
+    ts_writeUint16(vbus->ownRxAddr, buf, &wptr);
+    buf[wptr ++] = mapLen;
+    wptr += vbus->writeLinkState(&(buf[wptr]), mapLen);
+  }
+  ts_writeUint16(indice, buf, &wptr);
+  ts_writeUint16((parent != nullptr ? parent->numChildren : 0), buf, &wptr);
+  ts_writeUint16(numChildren, buf, &wptr);
+  ts_writeUint32(topoVersion, buf, &wptr);
+  ts_writeUint32(nameLen, buf, &wptr);
+  memcpy(&(buf[wptr]), name.c_str(), nameLen);
+  wptr += nameLen;
+  return wptr;
+}
+
+// next vertex in a batch, or nullptr at the end: pre-order within top's subtree, or along top's children 
+static Vertex* scopeBatchNext(Vertex* vt, Vertex* top, uint8_t mode){
+  if(mode == SCOPE_MODE_SIBLINGS){
+    if(vt->parent == nullptr || vt->indice + 1 >= vt->parent->numChildren) return nullptr;
+    return vt->parent->children[vt->indice + 1];
+  }
+  if(vt->numChildren > 0) return vt->children[0];
+  while(vt != top && vt->parent != nullptr){
+    if(vt->indice + 1 < vt->parent->numChildren) return vt->parent->children[vt->indice + 1];
+    vt = vt->parent;
+  }
+  return nullptr;
+}
+
+void Vertex::scopeBatchHandler(stackItem* item, uint16_t ptr){
+  uint8_t id = item->data[ptr + 2];
+  uint16_t rptr = ptr + 3;
+  uint32_t timeTag = ts_readUint32(item->data, &rptr);
+  uint8_t mode = item->data[ptr + 7] & SCOPE_MODE_MASK;
+  uint16_t ordinal = (item->len >= ptr + 10 ? ts_readUint16(item->data, ptr + 8) : 0);
+  // find where to start, 
+  Vertex* vt = nullptr;
+  if(mode == SCOPE_MODE_SIBLINGS){
+    if(parent == nullptr){
+      vt = (ordinal == 0 ? this : nullptr);
+    } else if (ordinal < parent->numChildren){
+      vt = parent->children[ordinal];
+    }
+  } else {
+    vt = this;
+    for(uint16_t o = 0; o < ordinal && vt != nullptr; o ++){
+      vt = scopeBatchNext(vt, this, mode);
+    }
+  }
+  // replies can be as long as the request's segSize allows, less the route back (as long as the request's up-to its ptr) 
+  uint16_t maxLen = min((uint16_t)VT_SLOTSIZE, ts_readUint16(item->data, 2));
+  uint16_t budget = (maxLen > ptr + 1 ? maxLen - (ptr + 1) : 0);
+  // packets until we're out of vertices, or stack, 
+  // (a request that starts past the end still gets one, empty, last packet) 
+  stackItem* slots[2];
+  do {
+    // is there room for this one, and will there be for another ? 
+    uint8_t free = stackReserveSlots(this, VT_STACK_DESTINATION, slots, 2);
+    if(free == 0) break;
+    uint16_t wptr = 0;
+    payload[wptr ++] = PK_SCOPERES;
+    payload[wptr ++] = id;
+    ts_writeUint32(scopeTimeTag, payload, &wptr);
+    payload[wptr ++] = SCOPE_BATCH_RES;
+    payload[wptr ++] = mode;
+    ts_writeUint16(ordinal, payload, &wptr);
+    uint16_t countPtr = wptr;
+    payload[wptr ++] = 0;
+    uint16_t flagsPtr = wptr;
+    payload[wptr ++] = 0;
+    uint8_t count = 0;
+    while(vt != nullptr && count < 255 && wptr < budget){
+      uint16_t recLen = vt->writeScopeRecord(&(payload[wptr]), budget - wptr, timeTag, count == 0);
+      if(recLen == 0) break;
+      wptr += recLen;
+      count ++;
+      vt = scopeBatchNext(vt, this, mode);
+    }
+    // nothing fits at all (segSize is tiny): say so, w/ an empty last packet 
+    if(count == 0) vt = nullptr;
+    ordinal += count;
+    payload[countPtr] = count;
+    if(vt == nullptr){
+      payload[flagsPtr] = SCOPE_BATCH_END;
+    } else if (free < 2){
+      payload[flagsPtr] = SCOPE_BATCH_STALLED;
+    }
+    uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+    if(len == 0) break;
+    stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+    if(free < 2) break;
+  } while(vt != nullptr);
+  stackClearSlot(item);
+}
 
 void Vertex::onOriginStackClear(uint8_t slot){
   if(onOriginStackClear_cb != nullptr) return onOriginStackClear_cb(this, slot);
@@ -144,6 +298,33 @@ VPort::VPort(
   vport = this; 
 }
 
+uint16_t VPort::injestStream(const uint8_t* bytes, uint16_t len){
+  uint16_t rptr = 0;
+  while(rptr < len){
+    // need somewhere to put it, 
+    if(rxSlot == nullptr){
+      rxSlot = stackReserveSlot(this, VT_STACK_ORIGIN);
+      if(rxSlot == nullptr) break;
+      cobsStreamBegin(&rxDecoder, rxSlot->data, VT_SLOTSIZE);
+    }
+    size_t consumed = 0;
+    uint8_t res = cobsStreamFeed(&rxDecoder, &(bytes[rptr]), len - rptr, &consumed);
+    rptr += consumed;
+    if(res == COBS_STREAM_FRAME){
+      if(rxDecoder.len > 0){
+        stackCommitSlot(rxSlot, rxDecoder.len);
+        rxSlot = nullptr;
+      } else {
+        cobsStreamBegin(&rxDecoder, rxSlot->data, VT_SLOTSIZE);
+      }
+    } else if (res == COBS_STREAM_ERROR){
+      // decoder drops the partial & carries on in the same slot, 
+      rxFramingErrors ++;
+    }
+  }
+  return rptr;
+}
+
 // ---------------------------------------------- VBus Constructor and Defaults 
 
 VBus::VBus(
@@ -156,40 +337,456 @@ VBus::VBus(
   for(uint8_t ch = 0; ch < VBUS_MAX_BROADCAST_CHANNELS; ch ++){
     broadcastChannels[ch] = nullptr;
   }
+  for(uint8_t s = 0; s < VT_STACKSIZE; s ++){
+    slotDrop[s] = VBUS_NO_DROP;
+    dropQueued[s] = 0;
+  }
 }
 
-void VBus::injestBroadcastPacket(uint8_t* data, uint16_t len, uint8_t broadcastChannel){
+// frames in our destination stack that are bus-forwards to this drop, 
+uint8_t VBus::queuedFor(uint16_t rxAddr){
+  for(uint8_t d = 0; d < VT_STACKSIZE; d ++){
+    if(dropQueued[d] > 0 && dropAddr[d] == rxAddr) return dropQueued[d];
+  }
+  return 0;
+}
+
+// a slot was just loaded into our destination stack, if it's a bus-forward, tag it & count it against its drop, 
+void VBus::queueLoaded(stackItem* item){
+  slotDrop[item->indice] = VBUS_NO_DROP;
+  uint16_t ptr = 0;
+  if(!findPtr(item->data, &ptr)) return;
+  if(PK_READKEY(item->data[ptr + 1]) != PK_BFWD) return;
+  uint16_t rxAddr = readArg(item->data, ptr + 1);
+  int16_t spare = -1;
+  for(uint8_t d = 0; d < VT_STACKSIZE; d ++){
+    if(dropQueued[d] == 0){
+      if(spare < 0) spare = d;
+    } else if(dropAddr[d] == rxAddr){
+      dropQueued[d] ++;
+      slotDrop[item->indice] = rxAddr;
+      return;
+    }
+  }
+  // one counter per occupied slot at most, so there's always a free one 
+  if(spare < 0) return;
+  dropAddr[spare] = rxAddr;
+  dropQueued[spare] = 1;
+  slotDrop[item->indice] = rxAddr;
+}
+
+// and one was cleared, 
+void VBus::queueCleared(stackItem* item){
+  uint16_t rxAddr = slotDrop[item->indice];
+  if(rxAddr == VBUS_NO_DROP) return;
+  slotDrop[item->indice] = VBUS_NO_DROP;
+  for(uint8_t d = 0; d < VT_STACKSIZE; d ++){
+    if(dropQueued[d] > 0 && dropAddr[d] == rxAddr){
+      dropQueued[d] --;
+      return;
+    }
+  }
+}
+
+// send as many queued bus-forwards as the drops will take, round-robin by rxAddr & oldest-first within each, 
+// runs before the loop collects items, so anything left here is blocked & the loop skips past it as usual 
+void VBus::serviceOutputQueues(void){
+  stackItem* items[VT_STACKSIZE];
+  uint16_t addrs[VT_STACKSIZE];
+  boolean ready[VT_STACKSIZE];
+  // aggregates that have been held long enough go 1st, 
+  for(uint8_t s = 0; s < VBUS_AGG_SLOTS; s ++){
+    if(aggLen[s] > 0 && micros() - aggStartMicros[s] >= aggHoldMicros) flushAggregate(s);
+  }
+  uint8_t count = stackGetItems(this, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  if(count == 0) return;
+  uint32_t now = millis();
+  // collect live bus-forwards & their drops, 
+  for(uint8_t i = 0; i < count; i ++){
+    ready[i] = false;
+    if(items[i]->borrowed) continue;
+    if(ts_readUint16(items[i]->data, 0) < now - items[i]->arrivalTime) continue; // dead, loop will clear it 
+    addrs[i] = slotDrop[items[i]->indice];
+    ready[i] = (addrs[i] != VBUS_NO_DROP);
+  }
+  for(uint8_t s = 0; s < count; s ++){
+    // next drop after the last one served, that has something waiting, 
+    int16_t pick = -1;
+    uint16_t pickDist = 0;
+    for(uint8_t i = 0; i < count; i ++){
+      if(!ready[i]) continue;
+      uint16_t dist = addrs[i] - lastServedAddr - 1;
+      if(pick < 0 || dist < pickDist){
+        pick = i;
+        pickDist = dist;
+      }
+    }
+    if(pick < 0) return;
+    if(clearToForward(addrs[pick], items[pick]->len, false)){
+      uint16_t ptr = 0;
+      if(findPtr(items[pick]->data, &ptr) && walkPtr(items[pick]->data, this, 1, ptr)){
+        forward(items[pick]->data, items[pick]->len, addrs[pick], false);
+      } else {
+        OSAP_ERROR(TRACE_BFWD_BAD_WALK, MINOR, this, addrs[pick]);
+      }
+      ready[pick] = false;
+      lastServedAddr = addrs[pick];
+      stackClearSlot(items[pick]);
+    } else {
+      // this drop is blocked for the rest of this pass, 
+      uint16_t blocked = addrs[pick];
+      for(uint8_t i = 0; i < count; i ++){
+        if(ready[i] && addrs[i] == blocked) ready[i] = false;
+      }
+    }
+  }
+}
+
+// ---------------------------------------------- VBus Frame Aggregation 
+
+void VBus::setAggregation(uint16_t mtu, uint32_t holdMicros){
+  if(mtu > VBUS_AGG_BUFSIZE) mtu = VBUS_AGG_BUFSIZE;
+  // whatever's held goes out in the old mode, 
+  flushAggregate();
+  aggMtu = mtu;
+  aggHoldMicros = holdMicros;
+  for(uint8_t s = 0; s < VBUS_AGG_SLOTS; s ++){
+    if(aggMtu > 0 && aggBuf[s] == nullptr) aggBuf[s] = new uint8_t[VBUS_AGG_BUFSIZE];
+    aggLen[s] = 0;
+    aggCount[s] = 0;
+  }
+}
+
+// the slot holding an aggregate for this destination, or -1 
+int8_t VBus::findAggregate(uint8_t key, uint16_t arg){
+  for(uint8_t s = 0; s < VBUS_AGG_SLOTS; s ++){
+    if(aggLen[s] > 0 && aggBuf[s][0] == key && ts_readUint16(aggBuf[s], 1) == arg) return s;
+  }
+  return -1;
+}
+
+// ships a held frame if the link will take it, true if nothing is held there afterwards 
+boolean VBus::flushAggregate(uint8_t slot){
+  if(aggLen[slot] == 0) return true;
+  uint8_t* buf = aggBuf[slot];
+  uint16_t arg = ts_readUint16(buf, 1);
+  if(buf[0] == VBUS_AGG_BROADCAST){
+    if(!ctb(arg)) return false;
+    broadcast(buf, aggLen[slot], arg);
+  } else {
+    if(!cts(arg)) return false;
+    send(buf, aggLen[slot], arg);
+  }
+  aggLen[slot] = 0;
+  aggCount[slot] = 0;
+  return true;
+}
+
+// likewise, for everything held, 
+boolean VBus::flushAggregate(void){
+  boolean clear = true;
+  for(uint8_t s = 0; s < VBUS_AGG_SLOTS; s ++){
+    if(!flushAggregate(s)) clear = false;
+  }
+  return clear;
+}
+
+boolean VBus::clearToForward(uint16_t arg, uint16_t len, boolean isBroadcast){
+  if(aggMtu == 0) return (isBroadcast ? ctb(arg) : cts(arg));
+  if(len + VBUS_AGG_HEADER + 2 > aggMtu){
+    OSAP_ERROR(TRACE_AGG_OVERSIZE, MEDIUM, this, len, aggMtu);
+    // say yes, so that it's cleared, forward() drops it 
+    return true;
+  }
+  // if something's held for this destination, we go behind it, or it has to go 1st, 
+  uint8_t key = (isBroadcast ? VBUS_AGG_BROADCAST : VBUS_AGG_UNICAST);
+  int8_t held = findAggregate(key, arg);
+  if(held >= 0){
+    if(aggLen[held] + 2 + len > aggMtu) return flushAggregate(held);
+    return true;
+  }
+  // otherwise we only open one for a destination that'll take it, 
+  if(!(isBroadcast ? ctb(arg) : cts(arg))) return false;
+  // and if every slot is held (by other drops, that may be blocked), forward() sends this one on its own 
+  return true;
+}
+
+void VBus::forward(uint8_t* data, uint16_t len, uint16_t arg, boolean isBroadcast){
+  OSAP_CAPTURE(CAPTURE_POINT_BUS_TX, this, data, len, 0, (isBroadcast ? PK_BBRD : PK_BFWD));
+  if(aggMtu == 0){
+    if(isBroadcast){
+      broadcast(data, len, arg);
+    } else {
+      send(data, len, arg);
+    }
+    return;
+  }
+  if(len + VBUS_AGG_HEADER + 2 > aggMtu) return; // oversize, complained about in clearToForward()
+  uint8_t key = (isBroadcast ? VBUS_AGG_BROADCAST : VBUS_AGG_UNICAST);
+  int8_t slot = findAggregate(key, arg);
+  if(slot < 0){
+    // a free slot, or one whose drop will take what's in it now, 
+    for(uint8_t s = 0; s < VBUS_AGG_SLOTS; s ++){
+      if(aggLen[s] == 0){ slot = s; break; }
+    }
+    for(uint8_t s = 0; s < VBUS_AGG_SLOTS && slot < 0; s ++){
+      if(flushAggregate(s)) slot = s;
+    }
+  }
+  if(slot < 0){
+    // all held for drops that are stalled: this goes out as an aggregate-of-one, 
+    uint8_t frame[VBUS_AGG_BUFSIZE];
+    uint16_t wptr = 0;
+    frame[wptr ++] = key;
+    ts_writeUint16(arg, frame, &wptr);
+    ts_writeUint16(len, frame, &wptr);
+    memcpy(&(frame[wptr]), data, len);
+    wptr += len;
+    if(isBroadcast){
+      broadcast(frame, wptr, arg);
+    } else {
+      send(frame, wptr, arg);
+    }
+    return;
+  }
+  uint8_t* buf = aggBuf[slot];
+  if(aggLen[slot] == 0){
+    buf[aggLen[slot] ++] = key;
+    ts_writeUint16(arg, buf, &(aggLen[slot]));
+    aggStartMicros[slot] = micros();
+  }
+  ts_writeUint16(len, buf, &(aggLen[slot]));
+  memcpy(&(buf[aggLen[slot]]), data, len);
+  aggLen[slot] += len;
+  aggCount[slot] ++;
+  // if it's too full to take even a minimum datagram, or we aren't holding, don't wait around 
+  if(aggLen[slot] + 2 + 6 > aggMtu || aggHoldMicros == 0) flushAggregate(slot);
+}
+
+// walks an aggregate's entries, returning how many are well-formed (up to the 1st bad one) 
+static uint8_t countAggregateEntries(uint8_t* frame, uint16_t len){
+  uint16_t rptr = VBUS_AGG_HEADER;
+  uint8_t count = 0;
+  while(rptr + 2 <= len){
+    uint16_t dgLen = ts_readUint16(frame, rptr);
+    rptr += 2;
+    if(dgLen == 0 || rptr + dgLen > len || dgLen > VT_SLOTSIZE) break;
+    rptr += dgLen;
+    count ++;
+  }
+  return count;
+}
+
+// true if every datagram in an rx'd aggregate has a slot waiting for it: 
+// unicasts need one each, broadcasts need one per subscriber, 
+boolean VBus::aggregateFits(uint8_t* frame, uint16_t len){
+  if(len < VBUS_AGG_HEADER) return true;
+  uint16_t need = countAggregateEntries(frame, len);
+  if(frame[0] == VBUS_AGG_BROADCAST){
+    uint16_t ch = ts_readUint16(frame, 1);
+    need *= (ch < VBUS_MAX_BROADCAST_CHANNELS ? countBroadcastSubscribers(ch) : 0);
+  }
+  if(need == 0) return true;
+  stackItem* slots[VT_STACKSIZE];
+  return stackReserveSlots(this, VT_STACK_ORIGIN, slots, VT_STACKSIZE) >= need;
+}
+
+// splits an rx'd aggregate frame back out: unicasts to our origin stack, broadcasts to channel subscribers, 
+// all-or-nothing, so one that won't fit is dropped whole rather than cut short, returns # of datagrams ingested 
+uint8_t VBus::unpackAggregate(uint8_t* frame, uint16_t len){
+  if(len < VBUS_AGG_HEADER) return 0;
+  uint8_t key = frame[0];
+  uint16_t arg = ts_readUint16(frame, 1);
+  if(key != VBUS_AGG_BROADCAST && key != VBUS_AGG_UNICAST){
+    OSAP_ERROR(TRACE_AGG_BAD_KEY, MEDIUM, this, key);
+    return 0;
+  }
+  // unicasts carry the whole rx addr, so one aimed at another drop isn't taken for ours 
+  if(key == VBUS_AGG_UNICAST && arg != ownRxAddr){
+    OSAP_ERROR(TRACE_AGG_NOT_OURS, MINOR, this, arg, ownRxAddr);
+    return 0;
+  }
+  if(!aggregateFits(frame, len)){
+    OSAP_DEBUG(TRACE_AGG_RX_FULL, DEFAULT, this);
+    return 0;
+  }
+  uint16_t rptr = VBUS_AGG_HEADER;
+  uint8_t injested = 0;
+  while(rptr + 2 <= len){
+    uint16_t dgLen = ts_readUint16(frame, rptr);
+    rptr += 2;
+    if(dgLen == 0 || rptr + dgLen > len || dgLen > VT_SLOTSIZE){
+      OSAP_ERROR(TRACE_AGG_MALFORMED, MEDIUM, this, len);
+      break;
+    }
+    if(key == VBUS_AGG_BROADCAST){
+      if(arg < VBUS_MAX_BROADCAST_CHANNELS && injestBroadcastPacket(&(frame[rptr]), dgLen, arg)) injested ++;
+    } else {
+      stackLoadSlot(this, VT_STACK_ORIGIN, &(frame[rptr]), dgLen);
+      injested ++;
+    }
+    rptr += dgLen;
+  }
+  return injested;
+}
+
+void VBus::setLinkState(uint16_t rxAddr, boolean open){
+  if(rxAddr >= addrSpaceSize) return;
+  // 1st edge: build the map, 
+  if(linkState == nullptr){
+    linkStateNumWords = (addrSpaceSize + 31) / 32;
+    linkState = new uint32_t[linkStateNumWords];
+    linkStateWordEpoch = new uint32_t[linkStateNumWords];
+    for(uint16_t w = 0; w < linkStateNumWords; w ++){
+      linkState[w] = 0;
+      linkStateWordEpoch[w] = 0;
+    }
+  }
+  uint16_t w = rxAddr >> 5;
+  if(w >= linkStateNumWords) return; // addrSpaceSize grew after the map was built, 
+  uint32_t bit = (uint32_t)1 << (rxAddr & 31);
+  // only edges count, 
+  if(((linkState[w] & bit) != 0) == open) return;
+  if(open){
+    linkState[w] |= bit;
+  } else {
+    linkState[w] &= ~bit;
+  }
+  linkStateEpoch ++;
+  linkStateWordEpoch[w] = linkStateEpoch;
+  bumpTopology();
+}
+
+// writes up-to maxBytes of the link-state bitmap into buf, one bit per addr, lsb first, returns bytes written 
+uint16_t VBus::writeLinkState(uint8_t* buf, uint16_t maxBytes){
+  uint16_t numBytes = (addrSpaceSize + 7) / 8;
+  if(numBytes > maxBytes) numBytes = maxBytes;
+  if(linkState != nullptr){
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // on little-endian hosts the words *are* the byte-wise map, 
+    memcpy(buf, linkState, numBytes);
+    #else 
+    for(uint16_t b = 0; b < numBytes; b ++){
+      buf[b] = (linkState[b >> 2] >> ((b & 3) * 8)) & 255;
+    }
+    #endif 
+  } else {
+    uint16_t addr = 0;
+    for(uint16_t b = 0; b < numBytes; b ++){
+      buf[b] = 0;
+      for(uint8_t i = 0; i < 8 && addr < addrSpaceSize; i ++, addr ++){
+        buf[b] |= (isOpen(addr) ? 1 : 0) << i;
+      }
+    }
+  }
+  return numBytes;
+}
+
+boolean VBus::injestBroadcastPacket(uint8_t* data, uint16_t len, uint16_t broadcastChannel){
   // ok so first we want to see if we have anything sub'd to this channel, so
-  if(broadcastChannels[broadcastChannel] != nullptr){
-    // we have a route, so we want to load this data *as we inject some new path segments* 
-    Route* route = broadcastChannels[broadcastChannel];
-    // we could definitely do this faster w/o using the stackLoadSlot fn, but we won't do that yet... 
-    // will use the vertex-global datagram stash for that 
-    uint16_t ptr = 0; 
-    if(!findPtr(data, &ptr)){ OSAP::error("can't find ptr during broadcast injest", MEDIUM); return; }
-    // packet should look like 
-    // ttl, segsize, <prev_instruct>, <bbrd_txAddr>, PTR, <payload>
-    // we want to inject the channel's route such that 
-    // ttl, segsize, <prev_instruct>, <bbrd_txAddr>, PTR, <ch_route>, <payload>
-    // shouldn't actually be too difficult, eh?
+  if(broadcastChannel >= VBUS_MAX_BROADCAST_CHANNELS || broadcastChannels[broadcastChannel] == nullptr) return false;
+  uint16_t ptr = 0; 
+  if(!findPtr(data, &ptr)){ OSAP_ERROR(TRACE_BRD_NO_PTR, MEDIUM, this, broadcastChannel); return false; }
+  // packet should look like 
+  // ttl, segsize, <prev_instruct>, <bbrd_txAddr>, PTR, <payload>
+  // we want to inject the channel's route such that 
+  // ttl, segsize, <prev_instruct>, <bbrd_txAddr>, PTR, <ch_route>, <payload>
+  // each subscriber gets its own slot, since routes are rewritten in place as they're walked, 
+  // but each is spliced straight from the rx'd frame, w/o any staging copies 
+  boolean injested = false;
+  for(broadcastSub* sub = broadcastChannels[broadcastChannel]; sub != nullptr; sub = sub->next){
+    Route* route = sub->route;
     // we do need to guard on lengths, 
-    if(len + route->pathLen > VT_SLOTSIZE){ OSAP::error("datagram + channel route is too large", MEDIUM); return; }
+    if(len + route->pathLen > VT_SLOTSIZE){ OSAP_ERROR(TRACE_BRD_OVERSIZE, MEDIUM, this, len + route->pathLen); continue; }
+    // and we splice it together right in the slot it'll live in, 
+    stackItem* item = stackReserveSlot(this, VT_STACK_ORIGIN);
+    if(item == nullptr){ OSAP_DEBUG(TRACE_BRD_RX_FULL, DEFAULT, this, broadcastChannel); break; }
     // copy up to PTR: pck[ptr] == PK_PTR, so we want to *include* this byte, having len ptr + 1, 
-    memcpy(datagram, data, ptr + 1);
+    memcpy(item->data, data, ptr + 1);
     // copy in route, but recall that as initialized, route->path[0] == PK_PTR, we don't want to double that up, 
-    memcpy(&(datagram[ptr + 1]), &(route->path[1]), route->pathLen - 1);
+    memcpy(&(item->data[ptr + 1]), &(route->path[1]), route->pathLen - 1);
     // then the rest of the gram, from just after-the-ptr, to end, 
-    memcpy(&datagram[ptr + 1 + route->pathLen - 1], &(data[ptr + 1]), len - ptr - 1);
-    // now we can load this in, 
-    stackLoadSlot(this, VT_STACK_ORIGIN, datagram, len + route->pathLen - 1);
-    // aye that's it innit? 
+    memcpy(&(item->data[ptr + route->pathLen]), &(data[ptr + 1]), len - ptr - 1);
+    stackCommitSlot(item, len + route->pathLen - 1);
+    injested = true;
+  }
+  return injested;
+}
+
+uint8_t VBus::injestBroadcastPackets(uint8_t** frames, uint16_t* lens, uint8_t* channels, uint8_t count){
+  uint8_t injested = 0;
+  for(uint8_t f = 0; f < count; f ++){
+    // once we're full, the rest of the batch is lost anyways, 
+    if(!stackEmptySlot(this, VT_STACK_ORIGIN)){
+      OSAP_DEBUG(TRACE_BRD_BATCH_FULL, DEFAULT, this, count - f);
+      break;
+    }
+    if(injestBroadcastPacket(frames[f], lens[f], channels[f])) injested ++;
   }
+  return injested;
 }
 
 void VBus::setBroadcastChannel(uint8_t channel, Route* route){
   if(channel >= VBUS_MAX_BROADCAST_CHANNELS) return;
   // seems a little sus, idk 
-  broadcastChannels[channel] = route;
+  // drop previous subscribers, taking care not to delete the route we're being handed, if it was one of 'em, 
+  while(broadcastChannels[channel] != nullptr){
+    broadcastSub* sub = broadcastChannels[channel];
+    broadcastChannels[channel] = sub->next;
+    if(sub->route != route) delete sub->route;
+    delete sub;
+  }
+  addBroadcastSubscriber(channel, route);
+}
+
+// appends a subscriber, returns its indice in the channel's list or -1 if it won't go, 
+int16_t VBus::addBroadcastSubscriber(uint8_t channel, Route* route){
+  if(channel >= VBUS_MAX_BROADCAST_CHANNELS || route == nullptr) return -1;
+  uint8_t count = countBroadcastSubscribers(channel);
+  if(count >= VBUS_MAX_CHANNEL_SUBSCRIBERS) return -1;
+  broadcastSub* sub = new broadcastSub;
+  sub->route = route;
+  broadcastSub** tail = &(broadcastChannels[channel]);
+  while(*tail != nullptr) tail = &((*tail)->next);
+  *tail = sub;
+  bumpTopology();
+  return count;
+}
+
+Route* VBus::getBroadcastChannel(uint8_t channel){
+  return getBroadcastSubscriber(channel, 0);
+}
+
+Route* VBus::getBroadcastSubscriber(uint8_t channel, uint8_t indice){
+  if(channel >= VBUS_MAX_BROADCAST_CHANNELS) return nullptr;
+  broadcastSub* sub = broadcastChannels[channel];
+  for(uint8_t i = 0; i < indice && sub != nullptr; i ++) sub = sub->next;
+  return (sub == nullptr ? nullptr : sub->route);
+}
+
+uint8_t VBus::countBroadcastSubscribers(uint8_t channel){
+  if(channel >= VBUS_MAX_BROADCAST_CHANNELS) return 0;
+  uint8_t count = 0;
+  for(broadcastSub* sub = broadcastChannels[channel]; sub != nullptr; sub = sub->next) count ++;
+  return count;
+}
+
+boolean VBus::removeBroadcastSubscriber(uint8_t channel, uint8_t indice){
+  if(channel >= VBUS_MAX_BROADCAST_CHANNELS) return false;
+  broadcastSub** link = &(broadcastChannels[channel]);
+  for(uint8_t i = 0; i < indice && *link != nullptr; i ++) link = &((*link)->next);
+  if(*link == nullptr) return false;
+  broadcastSub* sub = *link;
+  *link = sub->next;
+  delete sub->route;
+  delete sub;
+  bumpTopology();
+  return true;
+}
+
+void VBus::clearBroadcastChannel(uint8_t channel){
+  if(channel >= VBUS_MAX_BROADCAST_CHANNELS) return;
+  while(broadcastChannels[channel] != nullptr) removeBroadcastSubscriber(channel, 0);
 }
 
 void VBus::destHandler(stackItem* item, uint16_t ptr){
@@ -236,15 +833,17 @@ void VBus::destHandler(stackItem* item, uint16_t ptr){
         // the indice of the channel we're looking at, 
         uint16_t ch = item->data[ptr + 4];
         // if the ch exists, 
-        if(ch < VBUS_MAX_BROADCAST_CHANNELS && broadcastChannels[ch] != nullptr){
+        // this is the channel's 1st subscriber, VBUS_BROADCAST_SUB_QUERY_REQ gets at the others, 
+        Route* route = getBroadcastSubscriber(ch, 0);
+        if(route != nullptr){
           payload[wptr ++] = 1;
           // now... these are route objects, but we only use the path part... 
           // but we'll re-use route-object serialization schemes from EP_ROUTE_QUERY_REQ 
-          ts_writeUint16(broadcastChannels[ch]->ttl, payload, &wptr);
-          ts_writeUint16(broadcastChannels[ch]->segSize, payload, &wptr);
+          ts_writeUint16(route->ttl, payload, &wptr);
+          ts_writeUint16(route->segSize, payload, &wptr);
           // path copy 
-          memcpy(&(payload[wptr]), broadcastChannels[ch]->path, broadcastChannels[ch]->pathLen);
-          wptr += broadcastChannels[ch]->pathLen;
+          memcpy(&(payload[wptr]), route->path, route->pathLen);
+          wptr += route->pathLen;
         } else {
           payload[wptr ++] = 0;
         }
@@ -269,12 +868,12 @@ void VBus::destHandler(stackItem* item, uint16_t ptr){
         payload[wptr ++] = id;
         if(ch >= VBUS_MAX_BROADCAST_CHANNELS){
           // won't go 
-          OSAP::error("attempt to write to oob broadcast channel");
+          OSAP_ERROR(TRACE_BRD_CH_OOB, MINOR, this, ch);
           payload[wptr ++] = 0;
         } else {
           // should go 
           payload[wptr ++] = 1;          
-          if(broadcastChannels[ch] != nullptr) OSAP::debug("overwriting previous broadcast ch at " + String(ch));
+          if(broadcastChannels[ch] != nullptr) OSAP_DEBUG(TRACE_BRD_CH_OVERWRITE, DEFAULT, this, ch);
           uint16_t ttl = ts_readUint16(item->data, ptr + 5);
           uint16_t segSize = ts_readUint16(item->data, ptr + 7);
           uint8_t* path = &(item->data[ptr + 9]);
@@ -302,8 +901,8 @@ void VBus::destHandler(stackItem* item, uint16_t ptr){
         // can we rm ?
         if(ch < VBUS_MAX_BROADCAST_CHANNELS){
           if(broadcastChannels[ch] != nullptr) {
-            delete broadcastChannels[ch];
-            broadcastChannels[ch] = nullptr;
+            // rm's the whole channel, all subscribers, 
+            clearBroadcastChannel(ch);
             payload[wptr ++] = 1;
           } else {
             // didn't exist, so, a bad delete: 
@@ -319,8 +918,159 @@ void VBus::destHandler(stackItem* item, uint16_t ptr){
         stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
         break;
       }
+    case VBUS_BROADCAST_SUB_ADD_REQ:
+      // mvc requests to add a subscriber to a channel, alongside any others 
+      {
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = VBUS_BROADCAST_SUB_ADD_RES;
+        payload[wptr ++] = item->data[ptr + 3];
+        uint8_t ch = item->data[ptr + 4];
+        uint16_t ttl = ts_readUint16(item->data, ptr + 5);
+        uint16_t segSize = ts_readUint16(item->data, ptr + 7);
+        uint8_t* path = &(item->data[ptr + 9]);
+        uint16_t pathLen = item->len - (ptr + 10);
+        Route* route = new Route(path, pathLen, ttl, segSize);
+        int16_t indice = addBroadcastSubscriber(ch, route);
+        if(indice < 0){
+          delete route;
+          payload[wptr ++] = 0;
+          payload[wptr ++] = 0;
+        } else {
+          payload[wptr ++] = 1;
+          payload[wptr ++] = indice;
+        }
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+        break;
+      }
+    case VBUS_BROADCAST_SUB_QUERY_REQ:
+      // mvc requests one subscriber's route, w/ the count of all subscribers on that channel 
+      {
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = VBUS_BROADCAST_SUB_QUERY_RES;
+        payload[wptr ++] = item->data[ptr + 3];
+        uint8_t ch = item->data[ptr + 4];
+        uint8_t indice = item->data[ptr + 5];
+        Route* route = getBroadcastSubscriber(ch, indice);
+        if(route != nullptr){
+          payload[wptr ++] = 1;
+          payload[wptr ++] = countBroadcastSubscribers(ch);
+          ts_writeUint16(route->ttl, payload, &wptr);
+          ts_writeUint16(route->segSize, payload, &wptr);
+          memcpy(&(payload[wptr]), route->path, route->pathLen);
+          wptr += route->pathLen;
+        } else {
+          payload[wptr ++] = 0;
+          payload[wptr ++] = countBroadcastSubscribers(ch);
+        }
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+        break;
+      }
+    case VBUS_BROADCAST_SUB_RM_REQ:
+      // mvc requests to rm one subscriber, later ones shift down an indice 
+      {
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = VBUS_BROADCAST_SUB_RM_RES;
+        payload[wptr ++] = item->data[ptr + 3];
+        uint8_t ch = item->data[ptr + 4];
+        uint8_t indice = item->data[ptr + 5];
+        payload[wptr ++] = (removeBroadcastSubscriber(ch, indice) ? 1 : 0);
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+        break;
+      }
+    case VBUS_LINKSTATE_REQ:
+      // mvc requests the link-state map, paged by 32-bit words for big address spaces, 
+      {
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = VBUS_LINKSTATE_RES;
+        payload[wptr ++] = item->data[ptr + 3];
+        uint16_t startWord = ts_readUint16(item->data, ptr + 4);
+        ts_writeUint32(linkStateEpoch, payload, &wptr);
+        ts_writeUint16(addrSpaceSize, payload, &wptr);
+        ts_writeUint16(startWord, payload, &wptr);
+        // how many words fit ? 
+        uint16_t numWords = (addrSpaceSize + 31) / 32;
+        uint16_t maxLen = min((uint16_t)VT_SLOTSIZE, ts_readUint16(item->data, 2));
+        uint16_t fit = (maxLen > ptr + 1 + wptr + 1 ? (maxLen - (ptr + 1 + wptr + 1)) / 4 : 0);
+        uint16_t count = (startWord < numWords ? min((uint16_t)(numWords - startWord), fit) : 0);
+        if(count > 255) count = 255;
+        payload[wptr ++] = count;
+        if(count > 0){
+          if(linkState != nullptr){
+            // words go out little-endian, 
+            for(uint16_t w = 0; w < count; w ++){
+              uint16_t p = wptr + w * 4;
+              ts_writeUint32(linkState[startWord + w], payload, &p);
+            }
+          } else {
+            // untracked: poll it, which we can also do 32 at a time, 
+            for(uint16_t w = 0; w < count; w ++){
+              uint32_t word = 0;
+              for(uint8_t b = 0; b < 32; b ++){
+                uint16_t addr = (startWord + w) * 32 + b;
+                if(addr >= addrSpaceSize) break;
+                if(isOpen(addr)) word |= (uint32_t)1 << b;
+              }
+              uint16_t p = wptr + w * 4;
+              ts_writeUint32(word, payload, &p);
+            }
+          }
+          wptr += count * 4;
+        }
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+        break;
+      }
+    case VBUS_LINKSTATE_DELTA_REQ:
+      // mvc requests words that changed since an epoch it saw, in a reply to one of these or the above, 
+      {
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = VBUS_LINKSTATE_DELTA_RES;
+        payload[wptr ++] = item->data[ptr + 3];
+        uint16_t rptr = ptr + 4;
+        uint32_t since = ts_readUint32(item->data, &rptr);
+        ts_writeUint32(linkStateEpoch, payload, &wptr);
+        // complete-flag goes here, then count, then <word indice, word> pairs 
+        uint16_t completePos = wptr ++;
+        uint16_t countPos = wptr ++;
+        uint8_t count = 0;
+        boolean complete = true;
+        if(linkState == nullptr){
+          // no edges are tracked, so we can't say what's changed: they'll have to pull the whole map 
+          complete = false;
+        } else {
+          uint16_t maxLen = min((uint16_t)VT_SLOTSIZE, ts_readUint16(item->data, 2));
+          for(uint16_t w = 0; w < linkStateNumWords; w ++){
+            if((int32_t)(linkStateWordEpoch[w] - since) <= 0) continue;
+            if(ptr + 1 + wptr + 6 > maxLen || count == 255){
+              complete = false;
+              break;
+            }
+            ts_writeUint16(w, payload, &wptr);
+            ts_writeUint32(linkState[w], payload, &wptr);
+            count ++;
+          }
+        }
+        payload[completePos] = (complete ? 1 : 0);
+        payload[countPos] = count;
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+        break;
+      }
     default:
-      OSAP::error("vbus rx msg w/ unrecognized vbus key " + String(item->data[ptr + 2]) + " bailing", MINOR);
+      OSAP_ERROR(TRACE_VBUS_BAD_KEY, MINOR, this, item->data[ptr + 2]);
       stackClearSlot(item);
       break;
   } 
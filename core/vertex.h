@@ -19,9 +19,20 @@ no warranty is provided, and users accept all liability.
 #include "ts.h"
 #include "routes.h"
 #include "stack.h"
+#include "../utils/cobs.h"
 // vertex config is build dependent, define in <folder-containing-osape>/osapConfig.h 
 #include "./osap_config.h" 
 
+// the loop's scratch state (item list, payload / datagram stashes, error stash) is per-thread on hosts, 
+// so that each thread can run its own root... mcu builds have one root on one core, and no tls 
+#ifndef OSAP_THREAD_LOCAL
+#if defined(__linux__) || defined(__APPLE__)
+#define OSAP_THREAD_LOCAL thread_local 
+#else 
+#define OSAP_THREAD_LOCAL 
+#endif 
+#endif 
+
 // we have the vertex type, 
 // since it contains ptrs to others of its type, we fwd declare the type...
 class Vertex;
@@ -39,8 +50,8 @@ void vtOnDestinationStackClearDefault(Vertex* vt, uint8_t slot);
 class Vertex {
   public:
     // just temporary stashes, used all over the place to prep messages... 
-    static uint8_t payload[VT_SLOTSIZE];
-    static uint8_t datagram[VT_SLOTSIZE];
+    static OSAP_THREAD_LOCAL uint8_t payload[VT_SLOTSIZE];
+    static OSAP_THREAD_LOCAL uint8_t datagram[VT_SLOTSIZE];
     // -------------------------------- FN PTRS 
     // these are *genuine function ptrs* not member functions, my dudes 
     void (*loop_cb)(Vertex* vt) = nullptr;
@@ -52,6 +63,9 @@ class Vertex {
     virtual void destHandler(stackItem* item, uint16_t ptr);
     void pingRequestHandler(stackItem* item, uint16_t ptr);
     void scopeRequestHandler(stackItem* item, uint16_t ptr);
+    // batched scopes: this vertex (and its descendants, or its siblings) in as few replies as fit 
+    void scopeBatchHandler(stackItem* item, uint16_t ptr);
+    uint16_t writeScopeRecord(uint8_t* buf, uint16_t maxLen, uint32_t timeTag, boolean squeeze);
     virtual void onOriginStackClear(uint8_t slot);
     virtual void onDestinationStackClear(uint8_t slot);
     // -------------------------------- DATA
@@ -61,6 +75,10 @@ class Vertex {
     String name; 
     // a time tag, for when we were last scoped (need for graph traversals, final implementation tbd)
     uint32_t scopeTimeTag = 0;
+    // and a topology version, bumped whenever a child is added, a route or broadcast subscription changes, or 
+    // a link goes up or down, here or anywhere below us... so a mapper can skip subtrees that haven't moved 
+    uint32_t topoVersion = 0;
+    void bumpTopology(void);
     // stacks; 
     // origin stack[0] destination stack[1]
     // destination stack is for messages delivered to this vertex, 
@@ -74,8 +92,8 @@ class Vertex {
     Vertex* children[VT_MAXCHILDREN]; // I think this is OK on storage: just pointers 
     uint16_t numChildren = 0;
     // sometimes a vertex is a vport, sometimes it is a vbus, 
-    VPort* vport;
-    VBus* vbus;
+    VPort* vport = nullptr;
+    VBus* vbus = nullptr;
     // -------------------------------- CONSTRUCTORS 
     Vertex( 
       Vertex* _parent, 
@@ -96,36 +114,126 @@ class VPort : public Vertex {
     virtual void send(uint8_t* data, uint16_t len) = 0;
     virtual boolean cts(void) = 0;
     virtual boolean isOpen(void) = 0;
+    // streaming rx: implementations can hand raw cobs bytes from the line to injestStream() as they 
+    // arrive, frames decode directly into a reserved origin slot that's committed on the delimiter... 
+    // returns the # of bytes consumed, which is short of len when the stack is full (so, try again later),
+    // ports using this shouldn't also stackLoadSlot() into their origin stack 
+    uint16_t injestStream(const uint8_t* bytes, uint16_t len);
+    stackItem* rxSlot = nullptr;
+    COBSStreamDecoder rxDecoder;
+    uint32_t rxFramingErrors = 0;
     // base constructor, 
     VPort(Vertex* _parent, String _name);
 };
 
 // ---------------------------------------------- VBus 
 
+// a broadcast channel's subscribers are a little linked list of routes, 
+typedef struct broadcastSub {
+  Route* route;
+  broadcastSub* next = nullptr;
+} broadcastSub;
+
+// aggregate frames are <key>, <arg u16>, then <len u16, datagram> * n, and are at most this large, 
+#define VBUS_AGG_HEADER 3 
+#ifndef VBUS_AGG_BUFSIZE
+#define VBUS_AGG_BUFSIZE (VT_SLOTSIZE + VBUS_AGG_HEADER + 2)
+#endif 
+
+// how many drops / channels can have an aggregate held at once, 
+#ifndef VBUS_AGG_SLOTS
+#define VBUS_AGG_SLOTS 2 
+#endif 
+
+// how many local routes can subscribe to any one channel, 
+#ifndef VBUS_MAX_CHANNEL_SUBSCRIBERS
+#define VBUS_MAX_CHANNEL_SUBSCRIBERS 8 
+#endif 
+
+// how many of a bus' stack slots can be holding frames for any one drop: at most half of what the stack 
+// can hold (one slot is always kept free), so one busy drop can't out-queue the rest of them 
+#ifndef VBUS_DEFAULT_DROP_QUOTA
+#define VBUS_DEFAULT_DROP_QUOTA (VT_STACKSIZE > 3 ? (VT_STACKSIZE - 1) / 2 : 1)
+#endif 
+
+// destination slots that aren't holding a bus-forward are tagged w/ this, 
+#define VBUS_NO_DROP 0xFFFF 
+
 class VBus : public Vertex{
   public:
     // -------------------------------- Methods: these are purely virtual... 
-    virtual void send(uint8_t* data, uint16_t len, uint8_t rxAddr) = 0;
-    virtual void broadcast(uint8_t* data, uint16_t len, uint8_t broadcastChannel) = 0;
+    virtual void send(uint8_t* data, uint16_t len, uint16_t rxAddr) = 0;
+    virtual void broadcast(uint8_t* data, uint16_t len, uint16_t broadcastChannel) = 0;
     // clear to send, clear to broadcast, 
-    virtual boolean cts(uint8_t rxAddr) = 0;
-    virtual boolean ctb(uint8_t broadcastChannel) = 0;
+    virtual boolean cts(uint16_t rxAddr) = 0;
+    virtual boolean ctb(uint16_t broadcastChannel) = 0;
     // link state per rx-addr,
-    virtual boolean isOpen(uint8_t rxAddr) = 0;
+    virtual boolean isOpen(uint16_t rxAddr) = 0;
     // handle things aimed at us, for mvc etc 
     void destHandler(stackItem* item, uint16_t ptr) override;
-    // busses can read-in to broadcasts,
-    void injestBroadcastPacket(uint8_t* data, uint16_t len, uint8_t broadcastChannel);
-    // we have also... broadcast channels... these are little route stubs & channel pairs, which we just straight up index, 
-    Route* broadcastChannels[VBUS_MAX_BROADCAST_CHANNELS];
-    // have to update those... 
+    // busses can read-in to broadcasts, one at a time or a batch from one bus rx, returning # ingested 
+    boolean injestBroadcastPacket(uint8_t* data, uint16_t len, uint16_t broadcastChannel);
+    uint8_t injestBroadcastPackets(uint8_t** frames, uint16_t* lens, uint8_t* channels, uint8_t count);
+    // we have also... broadcast channels... each is a list of route stubs, and each frame rx'd on a channel is 
+    // fanned out to every route subscribed to it... set replaces all of a channel's subscribers w/ one route, 
+    // get returns the first (or nullptr), add / remove manage the rest, 
     void setBroadcastChannel(uint8_t channel, Route* route);
+    Route* getBroadcastChannel(uint8_t channel);
+    int16_t addBroadcastSubscriber(uint8_t channel, Route* route);
+    Route* getBroadcastSubscriber(uint8_t channel, uint8_t indice);
+    uint8_t countBroadcastSubscribers(uint8_t channel);
+    boolean removeBroadcastSubscriber(uint8_t channel, uint8_t indice);
+    void clearBroadcastChannel(uint8_t channel);
     // has an rx addr, 
     uint16_t ownRxAddr = 0;
     // has a width-of-addr-space, 
     uint16_t addrSpaceSize = 0;
+    // per-drop output queues: frames for each rxAddr are capped at dropQuota slots, and 
+    // drops that are clear to send are served round-robin, so a slow drop only stalls itself 
+    uint8_t dropQuota = VBUS_DEFAULT_DROP_QUOTA;
+    uint16_t lastServedAddr = 0;
+    uint8_t queuedFor(uint16_t rxAddr);
+    void serviceOutputQueues(void);
+    // ... counted as they're loaded & cleared (the stack calls these), rather than rescanning the stack: each 
+    // destination slot is tagged w/ the drop it's holding a frame for, and each drop w/ frames queued has a 
+    // counter, there can't be more of those than there are slots 
+    uint16_t slotDrop[VT_STACKSIZE];
+    uint16_t dropAddr[VT_STACKSIZE];
+    uint8_t dropQueued[VT_STACKSIZE];
+    void queueLoaded(stackItem* item);
+    void queueCleared(stackItem* item);
+    // frame aggregation: off by default, when on (w/ setAggregation(), at both ends of the link) every frame 
+    // carries one-or-more datagrams for the same rxAddr / channel, and rx'd frames go thru unpackAggregate()... 
+    // each held aggregate is for one destination, so a drop that won't take its frame only holds up itself 
+    uint8_t* aggBuf[VBUS_AGG_SLOTS] = { nullptr };
+    uint16_t aggMtu = 0;
+    uint32_t aggHoldMicros = 0;
+    uint16_t aggLen[VBUS_AGG_SLOTS] = { 0 };
+    uint8_t aggCount[VBUS_AGG_SLOTS] = { 0 };
+    uint32_t aggStartMicros[VBUS_AGG_SLOTS] = { 0 };
+    void setAggregation(uint16_t mtu, uint32_t holdMicros);
+    int8_t findAggregate(uint8_t key, uint16_t arg);
+    boolean flushAggregate(uint8_t slot);
+    boolean flushAggregate(void);
+    // rx'd aggregates go in whole or not at all: check that one fits before taking it off the wire, 
+    boolean aggregateFits(uint8_t* frame, uint16_t len);
+    uint8_t unpackAggregate(uint8_t* frame, uint16_t len);
+    // the loop forwards thru these, which aggregate (or not), 
+    boolean clearToForward(uint16_t arg, uint16_t len, boolean isBroadcast);
+    void forward(uint8_t* data, uint16_t len, uint16_t arg, boolean isBroadcast);
+    // link-state bitmap, one bit per rxAddr (addr 0 == lsb of word 0), kept by implementations 
+    // calling setLinkState() on edges... those that never do are polled w/ isOpen() instead 
+    uint32_t* linkState = nullptr;
+    uint32_t* linkStateWordEpoch = nullptr;   // epoch at which each word last changed 
+    uint16_t linkStateNumWords = 0;
+    uint32_t linkStateEpoch = 0;              // bumped on every edge, 32 bits so deltas don't alias in practice 
+    void setLinkState(uint16_t rxAddr, boolean open);
+    uint16_t writeLinkState(uint8_t* buf, uint16_t maxBytes);
     // base constructor, children inherit... 
     VBus(Vertex* _parent, String _name);
+  private: 
+    // n.b. this used to be a public Route*[], drivers should go thru the accessors above 
+    broadcastSub* broadcastChannels[VBUS_MAX_BROADCAST_CHANNELS];
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,68 @@
+/*
+osap/test/Arduino.h
+
+just enough of the arduino core to build osap on a host, for tests & benchmarks 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef ARDUINO_SHIM_H_
+#define ARDUINO_SHIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <type_traits>
+
+typedef bool boolean;
+
+// real clocks by default, tests that want a virtual one can shimSetClock() 
+unsigned long millis(void);
+unsigned long micros(void);
+void shimSetClock(unsigned long (*_micros)(void));
+
+template<class A, class B> typename std::common_type<A, B>::type min(A a, B b){ return (a < b ? a : b); }
+template<class A, class B> typename std::common_type<A, B>::type max(A a, B b){ return (a > b ? a : b); }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class String {
+  public:
+    std::string s;
+    String(void){}
+    String(const char* c) : s(c){}
+    String(const std::string& c) : s(c){}
+    String(int v) : s(std::to_string(v)){}
+    String(unsigned int v) : s(std::to_string(v)){}
+    String(long v) : s(std::to_string(v)){}
+    String(unsigned long v) : s(std::to_string(v)){}
+    String(double v) : s(std::to_string(v)){}
+    unsigned int length(void) const { return s.length(); }
+    void getBytes(unsigned char* buf, unsigned int len) const { 
+      if(!len) return; 
+      size_t n = (s.length() < len - 1 ? s.length() : len - 1); 
+      memcpy(buf, s.data(), n); 
+      buf[n] = 0; 
+    }
+    const char* c_str(void) const { return s.c_str(); }
+    friend String operator+(const String& a, const String& b){ return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b){ return String(a.s + b); }
+    friend String operator+(const char* a, const String& b){ return String(a + b.s); }
+};
+
+// serial writes are counted & dropped, 
+struct SerialShim { 
+  size_t written = 0;
+  size_t write(const uint8_t* buf, size_t len){ (void)buf; written += len; return len; } 
+};
+extern SerialShim Serial;
+
+#endif 
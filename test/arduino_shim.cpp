@@ -0,0 +1,35 @@
+/*
+osap/test/arduino_shim.cpp
+
+host clocks & serial for the arduino shim 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "Arduino.h"
+#include <time.h>
+
+SerialShim Serial;
+
+static unsigned long (*clockOverride)(void) = nullptr;
+
+void shimSetClock(unsigned long (*_micros)(void)){
+  clockOverride = _micros;
+}
+
+unsigned long micros(void){
+  if(clockOverride != nullptr) return clockOverride();
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+unsigned long millis(void){
+  return micros() / 1000;
+}
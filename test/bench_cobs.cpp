@@ -0,0 +1,54 @@
+/*
+osap/test/bench_cobs.cpp
+
+cobs encode / decode throughput, byte-at-a-time vs. run-at-a-time 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../utils/cobs.h"
+
+#define BYTES_PER_RUN (64 * 1024 * 1024)
+#define MAX_LEN 1024 
+
+static uint8_t in[MAX_LEN];
+static uint8_t enc[MAX_LEN + MAX_LEN / 254 + 16];
+static uint8_t dec[MAX_LEN + 16];
+
+// 'zeroEvery' 0 is no zeroes, 
+static void run(size_t len, uint32_t zeroEvery){
+  for(size_t i = 0; i < len; i ++) in[i] = ((zeroEvery && (i * 2654435761u) % zeroEvery == 0) ? 0 : (uint8_t)(i * 7 + 1) | 1);
+  uint32_t iters = BYTES_PER_RUN / len;
+  size_t encLen = cobsEncode(in, len, enc);
+  volatile size_t sink = 0;
+  double t0 = testSeconds();
+  for(uint32_t i = 0; i < iters; i ++){ sink += cobsEncode(in, len, enc); }
+  double t1 = testSeconds();
+  for(uint32_t i = 0; i < iters; i ++){ sink += cobsEncodeFast(in, len, enc); }
+  double t2 = testSeconds();
+  for(uint32_t i = 0; i < iters; i ++){ sink += cobsDecode(enc, encLen, dec); }
+  double t3 = testSeconds();
+  for(uint32_t i = 0; i < iters; i ++){ sink += cobsDecodeFast(enc, encLen, dec); }
+  double t4 = testSeconds();
+  double mb = (double)len * iters / 1e6;
+  printf("cobs %4zu B, zero 1/%-4u: encode %7.1f -> %7.1f MB/s, decode %7.1f -> %7.1f MB/s\n", 
+    len, zeroEvery, mb / (t1 - t0), mb / (t2 - t1), mb / (t3 - t2), mb / (t4 - t3));
+}
+
+int main(void){
+  run(64, 0);
+  run(64, 16);
+  run(256, 0);
+  run(256, 64);
+  run(1024, 0);
+  run(1024, 8);
+  run(1024, 128);
+  return 0;
+}
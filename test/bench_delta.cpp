@@ -0,0 +1,86 @@
+/*
+osap/test/bench_delta.cpp
+
+delta coding of sensor-ish frames: compression ratio & cpu cost 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "osap_config.h"
+#include "../utils/delta.h"
+
+#define FRAMES 200000
+
+// a frame of n float32 channels that drift slowly, w/ a frame counter up front, 
+// 'noisy' is how many channels get a new low-order reading each frame 
+static void nextFrame(float* chans, uint16_t n, uint32_t tick, uint8_t noisy, uint8_t* frame){
+  for(uint16_t c = 0; c < noisy && c < n; c ++){
+    chans[(tick * 7 + c * 13) % n] += 0.001f * (float)((tick + c) % 5);
+  }
+  memcpy(frame, &tick, 4);
+  memcpy(&(frame[4]), chans, n * 4);
+}
+
+// frames are built up front, so the timed loops are just the coding, 
+#define BATCH 1024 
+static uint8_t frames[BATCH][VT_SLOTSIZE];
+static uint8_t encoded[BATCH][VT_SLOTSIZE];
+static size_t encodedLen[BATCH];
+
+static void run(uint16_t n, uint8_t noisy){
+  uint16_t len = 4 + n * 4;
+  float chans[64];
+  for(uint16_t c = 0; c < n; c ++) chans[c] = c * 1.5f;
+  uint8_t dec[VT_SLOTSIZE];
+  uint64_t rawBytes = 0, wireBytes = 0;
+  double encTime = 0, decTime = 0;
+  uint32_t fails = 0;
+  uint32_t tick = 0;
+  for(uint32_t b = 0; b < FRAMES / BATCH; b ++){
+    for(uint16_t f = 0; f < BATCH; f ++) nextFrame(chans, n, tick ++, noisy, frames[f]);
+    // each frame against the one before it, as the endpoint does it: only if it's smaller than the frame, 
+    double t0 = testSeconds();
+    for(uint16_t f = 1; f < BATCH; f ++){
+      encodedLen[f] = deltaEncode(frames[f - 1], len, frames[f], len, encoded[f], len - 1);
+    }
+    double t1 = testSeconds();
+    for(uint16_t f = 1; f < BATCH; f ++){
+      if(encodedLen[f] == 0) continue;
+      if(deltaDecode(frames[f - 1], len, encoded[f], encodedLen[f], dec, VT_SLOTSIZE) != len) fails ++;
+    }
+    double t2 = testSeconds();
+    encTime += t1 - t0;
+    decTime += t2 - t1;
+    // tally & verify, outside the clock 
+    for(uint16_t f = 1; f < BATCH; f ++){
+      rawBytes += len + 2;                                          // EP_SS_ACKED, id, frame 
+      wireBytes += (encodedLen[f] ? encodedLen[f] + 3 : len + 2);   // EP_SS_DELTA, id, baseId, delta | keyframe 
+      if(encodedLen[f]){
+        deltaDecode(frames[f - 1], len, encoded[f], encodedLen[f], dec, VT_SLOTSIZE);
+        if(memcmp(dec, frames[f], len) != 0) fails ++;
+      }
+    }
+  }
+  double count = (double)(FRAMES / BATCH) * (BATCH - 1);
+  printf("delta %3u B frames, %2u changed ch: ratio %.3f (%5.1f B on the wire), encode %6.1f ns (%6.1f MB/s), decode %6.1f ns, %u mismatches\n", 
+    len, noisy, (double)wireBytes / rawBytes, (double)wireBytes / count, 
+    encTime * 1e9 / count, (double)len * count / encTime / 1e6, decTime * 1e9 / count, fails);
+}
+
+int main(void){
+  // 100 - 200 byte frames, w/ a few to most channels moving 
+  run(24, 1);
+  run(24, 4);
+  run(48, 1);
+  run(48, 4);
+  run(48, 16);
+  run(48, 48);
+  return 0;
+}
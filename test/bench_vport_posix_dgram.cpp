@@ -0,0 +1,208 @@
+/*
+osap/test/bench_vport_posix_dgram.cpp
+
+datagram ports over localhost (udp & unix): packets/s & round-trip latency,
+against a plain one-syscall-per-packet send() / recv() loop on the same kind of socket
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_posix_dgram.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define FRAMES 200000
+#define PINGS 20000
+// frames in flight, kept under what the kernel will buffer so that nothing is lost
+#define WINDOW 64
+
+OSAP osap("dgram_bench");
+
+// ---------------------------------------------- osap ports
+
+static void portThroughput(const char* label, VPortPosixDgram* a, VPortPosixDgram* b, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  memset(buf, 0x5a, len);
+  stackItem* items[VT_STACKSIZE];
+  uint32_t tx = 0, rx = 0, lost = 0;
+  uint32_t txCalls = a->txCalls, rxCalls = b->rxCalls;
+  double t0 = testSeconds();
+  double lastRx = t0;
+  while(rx + lost < FRAMES){
+    while(tx < FRAMES && tx - rx - lost < WINDOW && a->cts()){
+      a->send(buf, len);
+      tx ++;
+    }
+    a->loop();
+    posixPoll(0);
+    b->loop();
+    uint8_t count = stackGetItems(b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+    rx += count;
+    // anything still out after a quiet spell isn't coming, 
+    double now = testSeconds();
+    if(count > 0){
+      lastRx = now;
+    } else if(now - lastRx > 0.05){
+      lost = tx - rx;
+      lastRx = now;
+    }
+  }
+  double t1 = testSeconds();
+  printf("%-5s port, %3u B: %8.0f packets/s, %.2f sendmmsg & %.2f recvmmsg / packet, %u lost\n",
+    label, len, rx / (t1 - t0), (double)(a->txCalls - txCalls) / rx, (double)(b->rxCalls - rxCalls) / rx, lost);
+}
+
+// until both ends are bound, datagrams are refused & dropped: ping 'till one gets thru, 
+static void warmUp(VPortPosixDgram* a, VPortPosixDgram* b){
+  uint8_t buf[4] = { 1, 2, 3, 4 };
+  stackItem* items[VT_STACKSIZE];
+  double t0 = testSeconds();
+  while(testSeconds() - t0 < 1){
+    a->send(buf, 4);
+    a->loop();
+    posixPoll(1);
+    b->loop();
+    uint8_t count = stackGetItems(b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+    if(count > 0) break;
+  }
+}
+
+static void portLatency(const char* label, VPortPosixDgram* a, VPortPosixDgram* b, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  memset(buf, 0xa5, len);
+  stackItem* items[VT_STACKSIZE];
+  double t0 = testSeconds();
+  uint32_t done = 0;
+  for(; done < PINGS; done ++){
+    a->send(buf, len);
+    a->loop();
+    // b echoes,
+    while(stackGetItems(b, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 0){ posixPoll(0); b->loop(); }
+    b->send(items[0]->data, items[0]->len);
+    stackClearSlot(items[0]);
+    b->loop();
+    // & a waits for it,
+    while(stackGetItems(a, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 0){ posixPoll(0); a->loop(); }
+    stackClearSlot(items[0]);
+    if(testSeconds() - t0 > 20) break;
+  }
+  double t1 = testSeconds();
+  printf("%-5s port, %3u B: %6.2f us round trip\n", label, len, (t1 - t0) * 1e6 / done);
+}
+
+// ---------------------------------------------- baseline: a send() / recv() per packet
+
+static void rawThroughput(const char* label, int a, int b, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  memset(buf, 0x5a, len);
+  uint32_t tx = 0, rx = 0, calls = 0;
+  double t0 = testSeconds();
+  while(rx < FRAMES){
+    while(tx < FRAMES && tx - rx < WINDOW){
+      calls ++;
+      if(send(a, buf, len, 0) != len) break;
+      tx ++;
+    }
+    while(true){
+      calls ++;
+      if(recv(b, buf, VT_SLOTSIZE, 0) <= 0) break;
+      rx ++;
+    }
+    if(testSeconds() - t0 > 20) break;
+  }
+  double t1 = testSeconds();
+  printf("%-5s raw,  %3u B: %8.0f packets/s, %.2f syscalls / packet\n", label, len, rx / (t1 - t0), (double)calls / rx);
+}
+
+static void rawLatency(const char* label, int a, int b, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  memset(buf, 0xa5, len);
+  double t0 = testSeconds();
+  uint32_t done = 0;
+  for(; done < PINGS; done ++){
+    send(a, buf, len, 0);
+    ssize_t n;
+    while((n = recv(b, buf, VT_SLOTSIZE, 0)) <= 0);
+    send(b, buf, n, 0);
+    while(recv(a, buf, VT_SLOTSIZE, 0) <= 0);
+    if(testSeconds() - t0 > 20) break;
+  }
+  double t1 = testSeconds();
+  printf("%-5s raw,  %3u B: %6.2f us round trip\n", label, len, (t1 - t0) * 1e6 / done);
+}
+
+// a connected, nonblocking pair,
+static boolean udpPair(uint16_t portA, uint16_t portB, int* a, int* b){
+  sockaddr_in sa = {}, sb = {};
+  sa.sin_family = sb.sin_family = AF_INET;
+  sa.sin_addr.s_addr = sb.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sa.sin_port = htons(portA);
+  sb.sin_port = htons(portB);
+  *a = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  *b = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  return (*a >= 0 && *b >= 0 &&
+    bind(*a, (sockaddr*)&sa, sizeof(sa)) == 0 && bind(*b, (sockaddr*)&sb, sizeof(sb)) == 0 &&
+    connect(*a, (sockaddr*)&sb, sizeof(sb)) == 0 && connect(*b, (sockaddr*)&sa, sizeof(sa)) == 0);
+}
+
+static boolean unixPair(int* a, int* b){
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) != 0) return false;
+  *a = fds[0];
+  *b = fds[1];
+  return true;
+}
+
+int main(void){
+  const uint16_t lens[] = { 16, 128, VT_SLOTSIZE };
+  printf("%u slot stacks, so up to %u datagrams per recvmmsg\n", VT_STACKSIZE, VT_STACKSIZE - 1);
+  {
+    VPortPosixDgram a(&osap, "udp_a", "127.0.0.1", 47310, "127.0.0.1", 47311);
+    VPortPosixDgram b(&osap, "udp_b", "127.0.0.1", 47311, "127.0.0.1", 47310);
+    if(a.isOpen() && b.isOpen()){
+      warmUp(&a, &b);
+      for(uint16_t len : lens) portThroughput("udp", &a, &b, len);
+      for(uint16_t len : lens) portLatency("udp", &a, &b, len);
+    } else {
+      printf("udp: can't bind localhost ports, skipping\n");
+    }
+  }
+  {
+    VPortPosixDgram a(&osap, "unix_a", "/tmp/osap_bench_a.sock", "/tmp/osap_bench_b.sock");
+    VPortPosixDgram b(&osap, "unix_b", "/tmp/osap_bench_b.sock", "/tmp/osap_bench_a.sock");
+    if(a.isOpen() && b.isOpen()){
+      warmUp(&a, &b);
+      for(uint16_t len : lens) portThroughput("unix", &a, &b, len);
+      for(uint16_t len : lens) portLatency("unix", &a, &b, len);
+    }
+    unlink("/tmp/osap_bench_a.sock");
+    unlink("/tmp/osap_bench_b.sock");
+  }
+  int a, b;
+  if(udpPair(47312, 47313, &a, &b)){
+    for(uint16_t len : lens) rawThroughput("udp", a, b, len);
+    for(uint16_t len : lens) rawLatency("udp", a, b, len);
+  }
+  close(a);
+  close(b);
+  if(unixPair(&a, &b)){
+    for(uint16_t len : lens) rawThroughput("unix", a, b, len);
+    for(uint16_t len : lens) rawLatency("unix", a, b, len);
+  }
+  close(a);
+  close(b);
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+osap/test/bench_vport_posix_serial.cpp
+
+posix serial port throughput across a pty pair: frames/s & syscalls per frame
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_posix_serial.h"
+#include <fcntl.h>
+
+#define FRAMES 200000
+
+OSAP osap("pty_bench");
+
+static void run(VPortPosixSerial* a, VPortPosixSerial* b, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  for(uint16_t i = 0; i < len; i ++) buf[i] = (uint8_t)(i * 13);
+  stackItem* items[VT_STACKSIZE];
+  uint32_t tx = 0, rx = 0, passes = 0;
+  uint32_t writevBefore = a->writevCalls;
+  double t0 = testSeconds();
+  while(rx < FRAMES){
+    while(tx < FRAMES && a->cts()){
+      a->send(buf, len);
+      tx ++;
+    }
+    a->loop();
+    posixPoll(rx < tx ? 0 : 1);
+    b->loop();
+    uint8_t count = stackGetItems(b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+    rx += count;
+    passes ++;
+  }
+  double t1 = testSeconds();
+  uint32_t writevs = a->writevCalls - writevBefore;
+  printf("pty %3u B frames: %8.0f frames/s, %6.1f MB/s, %.3f writev / frame, %.2f passes / frame\n",
+    len, FRAMES / (t1 - t0), (double)FRAMES * len / (t1 - t0) / 1e6, (double)writevs / FRAMES, (double)passes / FRAMES);
+}
+
+int main(void){
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0){
+    printf("pty: can't open a pty pair, skipping\n");
+    return 0;
+  }
+  VPortPosixSerial a(&osap, "a", master);
+  VPortPosixSerial b(&osap, "b", ptsname(master));
+  run(&a, &b, 16);
+  run(&a, &b, 64);
+  run(&a, &b, 128);
+  run(&a, &b, VT_SLOTSIZE);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+osap/test/bench_vport_posix_shm.cpp
+
+shared-memory ports between two processes: frames/s one way, & round-trip latency
+w/ the echoing side busy-polling or futex-sleeping between frames
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_posix_shm.h"
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sched.h>
+
+#define FRAMES 500000
+#define PINGS 50000
+
+// 1st byte of each frame says what it's for,
+#define OP_DATA 1       // <op>, <seq u32>, filler
+#define OP_DONE 2       // <op>, <count u32>, <errors u32>: child has seen all the data
+#define OP_PING 3       // echoed as-is
+#define OP_SLEEPY 4     // <op>, <on>: child futex-sleeps (or spins) while idle
+#define OP_QUIT 5
+
+OSAP osap("shm_bench");
+
+// both sides spin while they wait, but yield in case they're sharing a core w/ the other one, 
+static void sendWhenClear(VPortPosixShm* port, uint8_t* data, uint16_t len){
+  while(!port->cts()){
+    port->loop();
+    sched_yield();
+  }
+  port->send(data, len);
+}
+
+static void child(const char* path){
+  VPortPosixShm* port = new VPortPosixShm(&osap, "b", path, 1);
+  stackItem* items[VT_STACKSIZE];
+  uint32_t count = 0, errors = 0;
+  boolean sleepy = false;
+  while(true){
+    if(sleepy) port->waitForRx(100000);
+    port->loop();
+    uint8_t n = stackGetItems(port, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    if(n == 0 && !sleepy) sched_yield();
+    for(uint8_t i = 0; i < n; i ++){
+      uint8_t* d = items[i]->data;
+      uint16_t rptr = 1;
+      switch(d[0]){
+        case OP_DATA:
+          if(ts_readUint32(d, &rptr) != count) errors ++;
+          count ++;
+          if(count == FRAMES){
+            uint8_t res[9];
+            uint16_t wptr = 0;
+            res[wptr ++] = OP_DONE;
+            ts_writeUint32(count, res, &wptr);
+            ts_writeUint32(errors, res, &wptr);
+            sendWhenClear(port, res, wptr);
+            count = 0;
+            errors = 0;
+          }
+          break;
+        case OP_PING:
+          sendWhenClear(port, d, items[i]->len);
+          break;
+        case OP_SLEEPY:
+          sleepy = (d[1] != 0);
+          break;
+        case OP_QUIT:
+          port->close();
+          _exit(0);
+      }
+      stackClearSlot(items[i]);
+    }
+  }
+}
+
+// waits for the next frame from the child, copies it out,
+static uint16_t receive(VPortPosixShm* port, uint8_t* out){
+  stackItem* items[VT_STACKSIZE];
+  while(true){
+    port->loop();
+    if(stackGetItems(port, VT_STACK_ORIGIN, items, VT_STACKSIZE) > 0){
+      uint16_t len = items[0]->len;
+      memcpy(out, items[0]->data, len);
+      stackClearSlot(items[0]);
+      return len;
+    }
+    sched_yield();
+  }
+}
+
+static void throughput(VPortPosixShm* port, uint16_t len){
+  uint8_t buf[VT_SLOTSIZE];
+  memset(buf, 0x5a, len);
+  buf[0] = OP_DATA;
+  double t0 = testSeconds();
+  for(uint32_t seq = 0; seq < FRAMES; seq ++){
+    uint16_t wptr = 1;
+    ts_writeUint32(seq, buf, &wptr);
+    sendWhenClear(port, buf, len);
+  }
+  uint8_t res[VT_SLOTSIZE];
+  receive(port, res);
+  double t1 = testSeconds();
+  uint16_t rptr = 1;
+  uint32_t count = ts_readUint32(res, &rptr);
+  uint32_t errors = ts_readUint32(res, &rptr);
+  printf("shm %3u B frames: %9.0f frames/s, %7.1f MB/s, %u rx'd, %u out of order\n",
+    len, FRAMES / (t1 - t0), (double)FRAMES * len / (t1 - t0) / 1e6, count, errors);
+}
+
+static void latency(VPortPosixShm* port, uint16_t len, boolean sleepy){
+  uint8_t buf[VT_SLOTSIZE];
+  uint8_t mode[2] = { OP_SLEEPY, (uint8_t)sleepy };
+  sendWhenClear(port, mode, 2);
+  memset(buf, 0xa5, len);
+  buf[0] = OP_PING;
+  uint32_t pings = (sleepy ? PINGS / 10 : PINGS);
+  uint32_t wakeups = port->wakeups;
+  double t0 = testSeconds();
+  for(uint32_t p = 0; p < pings; p ++){
+    sendWhenClear(port, buf, len);
+    receive(port, buf);
+  }
+  double t1 = testSeconds();
+  printf("shm %3u B ping-pong, echo side %s: %6.2f us round trip, %.2f futex wakes / ping\n",
+    len, (sleepy ? "futex-sleeping" : "spinning"), (t1 - t0) * 1e6 / pings, (double)(port->wakeups - wakeups) / pings);
+}
+
+int main(void){
+  char path[64];
+  snprintf(path, sizeof(path), "/dev/shm/osap-bench-%d", (int)getpid());
+  VPortPosixShm port(&osap, "a", path, 0);
+  if(!port.isOpen() && port.region == nullptr){
+    printf("shm: can't map %s, skipping\n", path);
+    return 0;
+  }
+  pid_t pid = fork();
+  if(pid == 0) child(path);
+  // wait for the child to attach,
+  while(!port.isOpen()) usleep(100);
+  throughput(&port, 16);
+  throughput(&port, 128);
+  throughput(&port, VT_SLOTSIZE);
+  latency(&port, 16, false);
+  latency(&port, VT_SLOTSIZE, false);
+  latency(&port, 16, true);
+  uint8_t quit = OP_QUIT;
+  sendWhenClear(&port, &quit, 1);
+  waitpid(pid, nullptr, 0);
+  port.close();
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+osap/test/bench_vport_thread_link.cpp
+
+thread links, scaling w/ thread count: n roots (one per thread, pinned) in a ring, each sending to
+the next & draining what the previous one sends it, frames/s in total & per thread
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_thread_link.h"
+#include <thread>
+#include <atomic>
+
+#define SECONDS 1.0
+#define MAX_THREADS 8
+#define FRAME_LEN 64
+
+typedef struct Shard {
+  OSAP* root;
+  VPortThreadLink* out;
+  VPortThreadLink* in;
+  uint32_t rx = 0;
+} Shard;
+
+static std::atomic<boolean> running;
+
+static void shardLoop(Shard* shard, uint16_t core){
+  pinCurrentThread(core);
+  uint8_t buf[FRAME_LEN];
+  memset(buf, 0x5a, FRAME_LEN);
+  stackItem* items[VT_STACKSIZE];
+  while(running.load(std::memory_order_relaxed)){
+    while(shard->out->cts()) shard->out->send(buf, FRAME_LEN);
+    shard->in->loop();
+    uint8_t count = stackGetItems(shard->in, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+    shard->rx += count;
+    if(count == 0) std::this_thread::yield();
+  }
+}
+
+static void run(uint16_t n, uint16_t cores){
+  Shard shards[MAX_THREADS];
+  for(uint16_t t = 0; t < n; t ++){
+    shards[t].root = new OSAP("shard_" + String(t));
+    shards[t].out = new VPortThreadLink(shards[t].root, "out");
+    shards[t].in = new VPortThreadLink(shards[t].root, "in");
+  }
+  // each one's out is the next one's in, w/ one thread that's a loopback
+  for(uint16_t t = 0; t < n; t ++) VPortThreadLink::connect(shards[t].out, shards[(t + 1) % n].in);
+  running.store(true);
+  std::thread threads[MAX_THREADS];
+  double t0 = testSeconds();
+  for(uint16_t t = 0; t < n; t ++) threads[t] = std::thread(shardLoop, &(shards[t]), t % cores);
+  while(testSeconds() - t0 < SECONDS) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  running.store(false);
+  for(uint16_t t = 0; t < n; t ++) threads[t].join();
+  double t1 = testSeconds();
+  uint64_t total = 0;
+  for(uint16_t t = 0; t < n; t ++) total += shards[t].rx;
+  printf("thread link, %u thread(s) on %u core(s): %10.0f frames/s total, %10.0f per thread\n",
+    n, cores, total / (t1 - t0), total / (t1 - t0) / n);
+  // unlink, each link is freed by whichever end lets go of it last
+  // (roots & ports are left standing, vertices aren't unhooked from their parents when they're deleted)
+  for(uint16_t t = 0; t < n; t ++){
+    shards[t].out->disconnect();
+    shards[t].in->disconnect();
+  }
+}
+
+int main(void){
+  uint16_t cores = std::thread::hardware_concurrency();
+  if(cores == 0) cores = 1;
+  for(uint16_t n = 1; n <= MAX_THREADS; n *= 2) run(n, cores);
+  return 0;
+}
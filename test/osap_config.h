@@ -0,0 +1,27 @@
+/*
+osap/test/osap_config.h
+
+build config for host tests & benchmarks 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef OSAP_CONFIG_H_
+#define OSAP_CONFIG_H_
+
+#define VT_SLOTSIZE 256 
+// benches that batch thru the stack build w/ a deeper one, see the Makefile 
+#ifndef VT_STACKSIZE
+#define VT_STACKSIZE 4 
+#endif 
+#define VT_MAXCHILDREN 16 
+#define VBUS_MAX_BROADCAST_CHANNELS 64 
+#define ENDPOINT_MAX_ROUTES 4 
+
+#endif 
@@ -0,0 +1,40 @@
+/*
+osap/test/test.h
+
+tiny check macros for host tests 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef OSAP_TEST_H_
+#define OSAP_TEST_H_
+
+#include <stdio.h>
+#include <time.h>
+
+// tests are plain programs: CHECK() counts failures, and main() returns TEST_RESULT() 
+inline int testFailures = 0;
+
+#define CHECK(cond) do { \
+  if(!(cond)){ \
+    testFailures ++; \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+  } \
+} while(0)
+
+#define TEST_RESULT() (testFailures == 0 ? (printf("%s: ok\n", __FILE__), 0) : (printf("%s: %d failed\n", __FILE__, testFailures), 1))
+
+// for benchmarks, 
+static inline double testSeconds(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif 
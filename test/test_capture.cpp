@@ -0,0 +1,87 @@
+/*
+osap/test/test_capture.cpp
+
+datagram capture: the ram ring, & the file ring as another process would read it 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/capture.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define RECORDS 4 
+#define WRITES 6 
+
+OSAP osap("capture_test");
+
+static void capture(uint32_t i){
+  uint8_t data[OSAP_CAPTURE_SNAPLEN + 16];
+  for(uint16_t b = 0; b < sizeof(data); b ++) data[b] = (uint8_t)(i + b);
+  // every other one is longer than the snap, 
+  uint16_t len = (i % 2 ? sizeof(data) : 10);
+  captureDatagram(CAPTURE_POINT_ITEM, &osap, data, len, 3, (uint8_t)i);
+}
+
+static boolean recordIs(captureRecord* rec, uint32_t i){
+  uint16_t len = (i % 2 ? OSAP_CAPTURE_SNAPLEN + 16 : 10);
+  if(rec->seq != i + 1 || rec->origLen != len || rec->key != (uint8_t)i) return false;
+  if(rec->inclLen != (len > OSAP_CAPTURE_SNAPLEN ? OSAP_CAPTURE_SNAPLEN : len)) return false;
+  if(rec->vtIndice != osap.indice || rec->point != CAPTURE_POINT_ITEM || rec->ptr != 3) return false;
+  for(uint16_t b = 0; b < rec->inclLen; b ++){
+    if(rec->data[b] != (uint8_t)(i + b)) return false;
+  }
+  return true;
+}
+
+int main(void){
+  // ram ring: reads pick up where they left off, & skip what's been overwritten 
+  {
+    CHECK(captureBegin(RECORDS));
+    captureRecord out[RECORDS];
+    uint32_t index = 0;
+    capture(0);
+    CHECK(captureRead(out, RECORDS, &index) == 1);
+    CHECK(index == 1 && recordIs(&out[0], 0));
+    for(uint32_t i = 1; i < WRITES; i ++) capture(i);
+    CHECK(captureRead(out, RECORDS, &index) == RECORDS);
+    CHECK(index == WRITES);
+    for(uint32_t r = 0; r < RECORDS; r ++) CHECK(recordIs(&out[r], WRITES - RECORDS + r));
+    captureEnd();
+  }
+  // file ring: read w/ plain read(), the way a tool w/o our headers' code would 
+  {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/osap-capture-test-%d", (int)getpid());
+    CHECK(captureBeginFile(path, RECORDS));
+    for(uint32_t i = 0; i < WRITES; i ++) capture(i);
+    captureEnd();
+    captureFileHeader header;
+    captureRecord rec;
+    int fd = open(path, O_RDONLY);
+    CHECK(fd >= 0);
+    CHECK(read(fd, &header, sizeof(header)) == sizeof(header));
+    CHECK(memcmp(&header.magic, "OSCP", 4) == 0);
+    CHECK(header.magic == CAPTURE_FILE_MAGIC && header.version == CAPTURE_FILE_VERSION);
+    CHECK(header.headerSize == sizeof(captureFileHeader) && header.recordSize == sizeof(captureRecord));
+    CHECK(header.snapLen == OSAP_CAPTURE_SNAPLEN && header.numRecords == RECORDS);
+    CHECK(header.writeIndex == WRITES);
+    // the newest RECORDS datagrams, each in slot (i % numRecords) 
+    for(uint32_t i = WRITES - RECORDS; i < WRITES; i ++){
+      off_t at = header.headerSize + (off_t)(i % header.numRecords) * header.recordSize;
+      CHECK(pread(fd, &rec, sizeof(rec), at) == sizeof(rec));
+      CHECK(recordIs(&rec, i));
+    }
+    close(fd);
+    unlink(path);
+  }
+  return TEST_RESULT();
+}
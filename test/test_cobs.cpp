@@ -0,0 +1,106 @@
+/*
+osap/test/test_cobs.cpp
+
+the run-at-a-time cobs coders match the originals byte-for-byte, incl. what they leave past the end 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../utils/cobs.h"
+
+#define MAX_LEN 1100 
+#define BUF_LEN (MAX_LEN + MAX_LEN / 254 + 16)
+
+static uint8_t in[BUF_LEN];
+static uint8_t encA[BUF_LEN], encB[BUF_LEN];
+static uint8_t decA[BUF_LEN], decB[BUF_LEN];
+
+static uint32_t rngState = 1;
+static uint32_t rng(void){
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// decodes both ways & compares, buffers are poisoned 1st so stray writes show up 
+static boolean sameDecode(const uint8_t* enc, size_t len){
+  memset(decA, 0xaa, BUF_LEN);
+  memset(decB, 0xaa, BUF_LEN);
+  size_t a = cobsDecode(enc, len, decA);
+  size_t b = cobsDecodeFast(enc, len, decB);
+  return a == b && memcmp(decA, decB, BUF_LEN) == 0;
+}
+
+// encodes both ways, compares, then round-trips 
+static boolean sameEncode(size_t len){
+  memset(encA, 0xaa, BUF_LEN);
+  memset(encB, 0xaa, BUF_LEN);
+  size_t a = cobsEncode(in, len, encA);
+  size_t b = cobsEncodeFast(in, len, encB);
+  if(a != b || memcmp(encA, encB, BUF_LEN) != 0) return false;
+  for(size_t i = 0; i < a; i ++){
+    if(encA[i] == 0) return false;
+  }
+  if(!sameDecode(encA, a)) return false;
+  return (cobsDecodeFast(encA, a, decB) == len && memcmp(decB, in, len) == 0);
+}
+
+int main(void){
+  // every length, all zeroes & no zeroes, 
+  for(size_t len = 0; len <= MAX_LEN; len ++){
+    memset(in, 0, len);
+    CHECK(sameEncode(len));
+    memset(in, 0x5a, len);
+    CHECK(sameEncode(len));
+  }
+  // every length up to a few blocks, w/ one zero at every position, 
+  for(size_t len = 1; len <= 600; len ++){
+    memset(in, 0x33, len);
+    for(size_t z = 0; z < len; z ++){
+      in[z] = 0;
+      if(!sameEncode(len)){
+        CHECK(false);
+        fprintf(stderr, "  one zero, len %zu at %zu\n", len, z);
+      }
+      in[z] = 0x33;
+    }
+  }
+  // zeroes every k bytes, at every phase, so runs end on & around block boundaries, 
+  for(size_t k = 1; k <= 300; k ++){
+    for(size_t phase = 0; phase < k && phase < 8; phase ++){
+      for(size_t i = 0; i < MAX_LEN; i ++) in[i] = ((i % k) == phase ? 0 : (uint8_t)(i | 1));
+      for(size_t len = 250; len <= 770; len += (len < 520 ? 1 : 9)){
+        if(!sameEncode(len)){
+          CHECK(false);
+          fprintf(stderr, "  periodic, k %zu phase %zu len %zu\n", k, phase, len);
+        }
+      }
+    }
+  }
+  // random buffers at a spread of zero densities, 
+  for(uint32_t r = 0; r < 60000; r ++){
+    size_t len = rng() % (MAX_LEN + 1);
+    uint32_t density = rng() % 6;
+    for(size_t i = 0; i < len; i ++){
+      uint32_t v = rng();
+      in[i] = ((density > 0 && (v >> 8) % (1 << (density * 2)) == 0) ? 0 : (uint8_t)(v | 1));
+    }
+    CHECK(sameEncode(len));
+  }
+  // & decoding junk: delimiters mid-frame, short final blocks, random bytes, 
+  for(uint32_t r = 0; r < 60000; r ++){
+    size_t len = rng() % (MAX_LEN + 1);
+    for(size_t i = 0; i < len; i ++) in[i] = (uint8_t)rng();
+    if(len > 0 && (r & 1)) in[rng() % len] = 0;
+    CHECK(sameDecode(in, len));
+  }
+  return TEST_RESULT();
+}
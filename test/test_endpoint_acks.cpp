@@ -0,0 +1,64 @@
+/*
+osap/test/test_endpoint_acks.cpp
+
+ack ids are unique while outstanding, and the ack table always finds them 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+
+OSAP osap("ack_test");
+Endpoint ep(&osap, "src");
+
+int main(void){
+  for(uint8_t r = 0; r < ENDPOINT_MAX_ROUTES; r ++){
+    ep.addRoute(new Route(), (r & 1 ? EP_ROUTEMODE_ACKED_WIDE : EP_ROUTEMODE_ACKED));
+  }
+  CHECK(ep.numRoutes == ENDPOINT_MAX_ROUTES);
+  // narrow ids walk the whole 8-bit space, not a per-slot slice of it, 
+  EndpointRoute* rt = ep.routes[0];
+  boolean seen[256] = { false };
+  uint16_t distinct = 0;
+  for(uint16_t n = 0; n < 300; n ++){
+    uint16_t id = ep.takeAckId(rt, false);
+    CHECK(id < 256);
+    if(!seen[id]){ seen[id] = true; distinct ++; }
+  }
+  CHECK(distinct == 256);
+  // churn: take & drop ids on random routes, every outstanding id should be findable, and unique 
+  uint32_t prng = 12345;
+  for(uint32_t n = 0; n < 200000; n ++){
+    prng = prng * 1103515245 + 12345;
+    EndpointRoute* r = ep.routes[(prng >> 16) % ep.numRoutes];
+    if((prng >> 8) & 1){
+      ep.takeAckId(r, r->ackMode == EP_ROUTEMODE_ACKED_WIDE);
+    } else if (r->ackOutstanding){
+      ep.ackTableRemove(r);
+      r->ackOutstanding = false;
+    }
+    for(uint8_t i = 0; i < ep.numRoutes; i ++){
+      EndpointRoute* q = ep.routes[i];
+      if(q->ackOutstanding){
+        if(ep.ackTableFind(q->ackId) != q){
+          CHECK(ep.ackTableFind(q->ackId) == q);
+          return TEST_RESULT();
+        }
+      }
+    }
+  }
+  // and the table never holds more than the outstanding routes, 
+  uint8_t held = 0, outstanding = 0;
+  for(uint16_t s = 0; s < EP_ACK_TABLE_SIZE; s ++) if(ep.ackTable[s] != nullptr) held ++;
+  for(uint8_t i = 0; i < ep.numRoutes; i ++) if(ep.routes[i]->ackOutstanding) outstanding ++;
+  CHECK(held == outstanding);
+  return TEST_RESULT();
+}
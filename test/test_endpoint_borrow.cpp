@@ -0,0 +1,143 @@
+/*
+osap/test/test_endpoint_borrow.cpp
+
+borrow-mode endpoints: retained slots are skipped by the loop, & acked once, on release 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/loop.h"
+#include "../vertices/endpoint.h"
+
+uint16_t borrows = 0;
+stackItem* held = nullptr;
+uint8_t heldFirst = 0;
+
+EP_ONBORROW_RESPONSES onBorrow(uint8_t* data, uint16_t, stackItem* handle){
+  borrows ++;
+  heldFirst = data[0];
+  held = handle;
+  return EP_BORROW_RETAIN;
+}
+
+OSAP osap("borrow_test");
+Endpoint ep(&osap, "sink", onBorrow);
+Endpoint src(&osap, "src");
+
+// for the delta run: copies each frame out, and tries to hold onto it (which is refused for rebuilt deltas) 
+uint8_t lastFrame[64];
+uint16_t lastLen = 0;
+uint16_t nullHandles = 0;
+
+EP_ONBORROW_RESPONSES onBorrowCopy(uint8_t* data, uint16_t len, stackItem* handle){
+  memcpy(lastFrame, data, len);
+  lastLen = len;
+  if(handle == nullptr){
+    nullHandles ++;
+    return EP_BORROW_RETAIN;
+  }
+  return EP_BORROW_CONSUMED;
+}
+
+// a gram from sibling 1 w/ this endpoint key (& id, if acked), left in ep's destination stack 
+static stackItem* deliver(uint8_t key, uint8_t id, uint8_t first){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_SIB;
+  gram[wptr ++] = 1;
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  gram[wptr ++] = key;
+  if(key == EP_SS_ACKED) gram[wptr ++] = id;
+  for(uint8_t i = 0; i < 16; i ++) gram[wptr ++] = first + i;
+  stackLoadSlot(&ep, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  return items[count - 1];
+}
+
+// ep's destination stack, & how many of 'em are acks for this id 
+static uint8_t destItems(uint8_t id, uint8_t* acks){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  *acks = 0;
+  for(uint8_t i = 0; i < count; i ++){
+    // ttl, segsize, ptr, the route back to sibling 1, then dest, key, id 
+    if(items[i]->data[7] == PK_DEST && items[i]->data[8] == EP_SS_ACK && items[i]->data[9] == id) (*acks) ++;
+  }
+  return count;
+}
+
+static void clearDest(void){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+}
+
+int main(void){
+  uint8_t acks = 0;
+  // an acked frame, retained, 
+  stackItem* item = deliver(EP_SS_ACKED, 42, 7);
+  ep.destHandler(item, 6);
+  CHECK(borrows == 1 && held == item && heldFirst == 7);
+  CHECK(item->borrowed);
+  // it's still in the slot, & not acked, 
+  CHECK(destItems(42, &acks) == 1 && acks == 0);
+  // the loop leaves it alone, however many times it runs, 
+  for(uint8_t l = 0; l < 8; l ++) osap.loop();
+  CHECK(borrows == 1);
+  CHECK(destItems(42, &acks) == 1 && acks == 0);
+  CHECK(item->borrowed && item->len > 0 && item->data[item->len - 16] == 7);
+  // handing it back frees the slot & acks it, 
+  ep.release(held);
+  CHECK(!item->borrowed);
+  CHECK(destItems(42, &acks) == 1 && acks == 1);
+  // a 2nd release is refused, & doesn't ack again 
+  ep.release(held);
+  CHECK(destItems(42, &acks) == 1 && acks == 1);
+  clearDest();
+  CHECK(destItems(42, &acks) == 0);
+  // ackless frames are just cleared on release, 
+  item = deliver(EP_SS_ACKLESS, 0, 100);
+  ep.destHandler(item, 6);
+  CHECK(borrows == 2 && held == item && heldFirst == 100 && item->borrowed);
+  osap.loop();
+  CHECK(destItems(0, &acks) == 1 && item->borrowed);
+  ep.release(held);
+  CHECK(destItems(0, &acks) == 0);
+  // a delta route into a borrow endpoint: every frame is acked, rebuilt & delivered, w/o timeouts 
+  ep.onBorrow_cb = onBorrowCopy;
+  uint8_t r = src.addRoute((new Route())->sib(0), EP_ROUTEMODE_ACKED_DELTA, 1000);
+  EndpointRoute* rt = src.routes[r];
+  uint8_t frame[64];
+  for(uint8_t i = 0; i < 64; i ++) frame[i] = i;
+  uint16_t stuck = 0;
+  for(uint16_t f = 0; f < 100; f ++){
+    frame[f % 64] ++;
+    src.write(frame, 64);
+    uint16_t l = 0;
+    for(; l < 16; l ++){
+      osap.loop();
+      if(rt->state == EP_TX_IDLE && rt->txVersion == src.version) break;
+    }
+    if(l == 16) stuck ++;
+    CHECK(lastLen == 64 && memcmp(lastFrame, frame, 64) == 0);
+  }
+  CHECK(stuck == 0);
+  CHECK(rt->timeoutCount == 0);
+  CHECK(rt->ackCount == 100);
+  // mostly deltas, which come w/ no handle to retain 
+  CHECK(nullHandles > 50);
+  CHECK(rt->txWireBytes < rt->txRawBytes);
+  return TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+/*
+osap/test/test_endpoint_delta.cpp
+
+delta frames are only rebuilt against the acked keyframe they were written for 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+#include "../utils/delta.h"
+
+OSAP osap("delta_test");
+Endpoint ep(&osap, "sink");
+
+// hands ep a gram that 'came from' sibling # sender, returns true if it was acked 
+static boolean deliver(uint8_t sender, uint8_t* pl, uint16_t len){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_SIB;
+  gram[wptr ++] = sender;
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  memcpy(&(gram[wptr]), pl, len);
+  wptr += len;
+  stackLoadSlot(&ep, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  ep.destHandler(items[count - 1], 6);
+  // anything left is the ack, 
+  count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  boolean acked = (count > 0 && items[0]->data[8] == EP_SS_ACK);
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[0]);
+  return acked;
+}
+
+static boolean keyframe(uint8_t sender, uint8_t id, uint8_t* frame, uint16_t len){
+  uint8_t pl[VT_SLOTSIZE];
+  pl[0] = EP_SS_ACKED;
+  pl[1] = id;
+  memcpy(&(pl[2]), frame, len);
+  return deliver(sender, pl, len + 2);
+}
+
+static boolean delta(uint8_t sender, uint8_t id, uint8_t baseId, uint8_t* base, uint8_t* frame, uint16_t len){
+  uint8_t pl[VT_SLOTSIZE];
+  pl[0] = EP_SS_DELTA;
+  pl[1] = id;
+  pl[2] = baseId;
+  uint16_t dlen = deltaEncode(base, len, frame, len, &(pl[3]), VT_SLOTSIZE - 16);
+  return deliver(sender, pl, dlen + 3);
+}
+
+static boolean holds(uint8_t* frame, uint16_t len){
+  return (ep.dataLen == len && memcmp(ep.data(), frame, len) == 0);
+}
+
+int main(void){
+  uint8_t f1[64], f2[64], f3[64];
+  for(uint8_t i = 0; i < 64; i ++){
+    f1[i] = i;
+    f2[i] = (i == 10 ? 99 : i);
+    f3[i] = 255 - i;
+  }
+  // the happy path, 
+  CHECK(keyframe(1, 5, f1, 64));
+  CHECK(delta(1, 6, 5, f1, f2, 64));
+  CHECK(holds(f2, 64));
+  // deltas chain off the last one, 
+  CHECK(delta(1, 7, 6, f2, f1, 64));
+  CHECK(holds(f1, 64));
+  // an ackless publish replaces the reference, so a delta against the keyframe is refused, 
+  CHECK(keyframe(1, 9, f1, 64));
+  uint8_t pl[VT_SLOTSIZE];
+  pl[0] = EP_SS_ACKLESS;
+  memcpy(&(pl[1]), f3, 64);
+  CHECK(!deliver(2, pl, 65));
+  CHECK(holds(f3, 64));
+  CHECK(!delta(1, 10, 9, f1, f2, 64));
+  CHECK(holds(f3, 64));
+  // as does a local write, 
+  CHECK(keyframe(1, 11, f1, 64));
+  ep.write(f3, 64);
+  CHECK(!delta(1, 12, 11, f1, f2, 64));
+  CHECK(holds(f3, 64));
+  // and a delta from another sender, whose id happens to match, isn't rebuilt against this one's keyframe, 
+  CHECK(keyframe(1, 13, f1, 64));
+  CHECK(!delta(2, 14, 13, f3, f2, 64));
+  CHECK(holds(f1, 64));
+  // ... til it sends its own, 
+  CHECK(keyframe(2, 13, f3, 64));
+  CHECK(delta(2, 14, 13, f3, f2, 64));
+  CHECK(holds(f2, 64));
+  return TEST_RESULT();
+}
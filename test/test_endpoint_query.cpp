@@ -0,0 +1,80 @@
+/*
+osap/test/test_endpoint_query.cpp
+
+queries inside the freshness window are answered from the store, w/o calling beforeQuery again 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+
+unsigned long fakeMicros = 1000000;
+unsigned long fakeClock(void){ return fakeMicros; }
+
+uint16_t refreshes = 0;
+Endpoint* ep = nullptr;
+
+// each refresh writes a new value, so replies show which refresh they came from 
+boolean beforeQuery(void){
+  refreshes ++;
+  uint8_t val = (uint8_t)refreshes;
+  ep->write(&val, 1);
+  return true;
+}
+
+OSAP osap("query_test");
+
+// queries ep, returns the 1st data byte of the reply (0 if there wasn't one) 
+static uint8_t query(void){
+  uint8_t gram[16];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  gram[wptr ++] = EP_QUERY;
+  gram[wptr ++] = 12;
+  stackLoadSlot(ep, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  ep->destHandler(items[count - 1], 4);
+  count = stackGetItems(ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  if(count != 1) return 0;
+  // ptr, dest, key, id, data 
+  uint8_t val = (items[0]->data[6] == EP_QUERY_RESP && items[0]->data[7] == 12 ? items[0]->data[8] : 0);
+  stackClearSlot(items[0]);
+  return val;
+}
+
+int main(void){
+  shimSetClock(fakeClock);
+  Endpoint endpoint(&osap, "src", beforeQuery);
+  ep = &endpoint;
+  // by default, every query refreshes, 
+  CHECK(query() == 1 && refreshes == 1);
+  CHECK(query() == 2 && refreshes == 2);
+  // w/ a 50ms window, the 1st query refreshes, & those inside the window are served from the store, 
+  ep->setQueryFreshness(50);
+  CHECK(query() == 3 && refreshes == 3);
+  for(uint8_t q = 0; q < 5; q ++){
+    fakeMicros += 9000;
+    CHECK(query() == 3);
+  }
+  CHECK(refreshes == 3);
+  // then the next one past it refreshes again, & opens a new window 
+  fakeMicros += 6000;
+  CHECK(query() == 4 && refreshes == 4);
+  fakeMicros += 49000;
+  CHECK(query() == 4 && refreshes == 4);
+  fakeMicros += 1000;
+  CHECK(query() == 5 && refreshes == 5);
+  return TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+/*
+osap/test/test_endpoint_rate.cpp
+
+paced routes: bursts are exactly as deep as asked, then sends space out at the rate, 
+the byte bucket pays for whole datagrams, & rate requests are length-checked 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+
+unsigned long fakeMicros = 1000;
+unsigned long fakeClock(void){ return fakeMicros; }
+
+OSAP osap("rate_test");
+Endpoint ep(&osap, "src");
+Endpoint burst(&osap, "burst");
+
+// clears burst's origin stack, returns how many went out 
+static uint8_t drain(void){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&burst, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+  return count;
+}
+
+// a fresh write & a loop at the current time, true if it went out 
+static boolean tryTx(void){
+  uint8_t frame[20] = { 0 };
+  burst.write(frame, 20);
+  burst.loop();
+  return drain() > 0;
+}
+
+// sends that make it out at one instant (the rest coalesce 'till later) 
+static uint16_t burstAt(unsigned long t){
+  fakeMicros = t;
+  uint16_t sent = 0;
+  for(uint16_t i = 0; i < 64; i ++) if(tryTx()) sent ++;
+  return sent;
+}
+
+// then, stepping the clock 1us at a time & writing each step: sends should be exactly the rate's interval apart 
+static boolean spacedAt(uint32_t interval){
+  unsigned long last = 0;
+  uint16_t gaps = 0;
+  for(uint32_t step = 0; step < 20000 && gaps < 10; step ++){
+    fakeMicros ++;
+    if(!tryTx()) continue;
+    if(last != 0){
+      if(fakeMicros - last != interval) return false;
+      gaps ++;
+    }
+    last = fakeMicros;
+  }
+  return gaps == 10;
+}
+
+// an EP_ROUTE_RATE_REQ, less cut bytes off its tail, returns the reply's ok byte (or 255 for no reply) 
+static uint8_t rateRequest(uint16_t r, uint32_t rateBytes, uint32_t burstBytes, uint16_t cut){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  gram[wptr ++] = EP_ROUTE_RATE_REQ;
+  gram[wptr ++] = 3;
+  ts_writeUint16(r, gram, &wptr);
+  ts_writeUint32(0, gram, &wptr);
+  ts_writeUint32(rateBytes, gram, &wptr);
+  ts_writeUint16(1, gram, &wptr);
+  ts_writeUint32(burstBytes, gram, &wptr);
+  stackLoadSlot(&burst, VT_STACK_DESTINATION, gram, wptr - cut);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&burst, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  burst.destHandler(items[count - 1], 4);
+  count = stackGetItems(&burst, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  if(count == 0) return 255;
+  // ptr, dest, key, id, ok 
+  uint8_t ok = items[0]->data[8];
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+  return ok;
+}
+
+int main(void){
+  shimSetClock(fakeClock);
+  // 300 datagrams' worth of default byte burst is > 64k, 
+  EndpointRoute rt(new Route(), EP_ROUTEMODE_ACKLESS);
+  rt.setRate(0, 1000000, 300);
+  CHECK(rt.byteTolerance == 300UL * VT_SLOTSIZE);
+  // 1 byte / us, so the bucket's tat moves by exactly the bytes charged, 
+  Route* route = (new Route())->sib(0)->sib(0);
+  uint8_t r = ep.addRoute(route, EP_ROUTEMODE_ACKLESS, 1000, 0, 1000000);
+  EndpointRoute* er = ep.routes[r];
+  uint32_t before = er->byteTat;
+  uint8_t frame[20] = { 0 };
+  ep.write(frame, 20);
+  ep.loop();
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+  CHECK(count == 1);
+  if(count == 1){
+    // ttl, segsize, route, PK_DEST, EP_SS_ACKLESS, frame 
+    CHECK(items[0]->len == 4 + route->pathLen + 2 + 20);
+    CHECK(er->byteTat - before == items[0]->len);
+  }
+  // datagram buckets: a burst of 3 at 1000/s, then 1000us apart, 
+  uint8_t b = burst.addRoute(new Route(), EP_ROUTEMODE_ACKLESS);
+  burst.routes[b]->setRate(1000, 0, 3);
+  CHECK(burstAt(100000) == 3);
+  CHECK(spacedAt(1000));
+  // & once it's idle long enough, the whole burst again, 
+  CHECK(burstAt(fakeMicros + 100000) == 3);
+  // byte buckets: 1 byte / us w/ room for exactly 5 of these datagrams, then a datagram's length apart, 
+  // (ttl, segsize, route, dest, key, 20 data bytes) 
+  uint16_t gramLen = 4 + burst.routes[b]->route->pathLen + 2 + 20;
+  burst.routes[b]->setRate(0, 1000000, 1, 5 * gramLen);
+  CHECK(burstAt(fakeMicros + 100000) == 5);
+  CHECK(spacedAt(gramLen));
+  // byte bursts can be set past 64k over the wire, 
+  CHECK(rateRequest(b, 1000000, 100000, 0) == 1);
+  CHECK(burst.routes[b]->byteTolerance == 100000);
+  // older requests w/ a u16 burstBytes still parse, 
+  CHECK(rateRequest(b, 1000000, 0, 2) == 1);
+  CHECK(burst.routes[b]->byteTolerance == VT_SLOTSIZE);
+  // but short ones are refused, & don't touch the route 
+  CHECK(rateRequest(b, 1000, 0, 8) == 0);
+  CHECK(burst.routes[b]->rateBytes == 1000000);
+  return TEST_RESULT();
+}
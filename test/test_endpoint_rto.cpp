@@ -0,0 +1,26 @@
+/*
+osap/test/test_endpoint_rto.cpp
+
+initial retransmit timeouts clamp, rather than wrap, for long given timeouts 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+
+int main(void){
+  CHECK(EndpointRoute(new Route(), EP_ROUTEMODE_ACKED, 1000).rto == 1000000);
+  CHECK(EndpointRoute(new Route(), EP_ROUTEMODE_ACKED, 0).rto == EP_RTO_MIN_US);
+  // ~ 72 minutes is where ms * 1000 used to wrap 32 bits, 
+  CHECK(EndpointRoute(new Route(), EP_ROUTEMODE_ACKED, 4295000).rto == EP_RTO_MAX_US);
+  CHECK(EndpointRoute(new Route(), EP_ROUTEMODE_ACKED, 0xffffffff).rto == EP_RTO_MAX_US);
+  return TEST_RESULT();
+}
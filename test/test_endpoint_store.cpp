@@ -0,0 +1,77 @@
+/*
+osap/test/test_endpoint_store.cpp
+
+double-buffered endpoint stores: writes between tx's coalesce, and snapshots hold still 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/endpoint.h"
+#include <type_traits>
+
+OSAP osap("store_test");
+Endpoint ep(&osap, "src");
+
+// data is a read-only view now, not a writable array member 
+static_assert(std::is_same<decltype(ep.data()), const uint8_t*>::value, "Endpoint::data() should be a const view");
+
+static void fill(uint8_t* buf, uint8_t v, uint16_t len){
+  for(uint16_t i = 0; i < len; i ++) buf[i] = v + i;
+}
+
+// origin-side grams, cleared as they're counted, w/ the 1st data byte of the last one 
+static uint8_t sent(uint8_t* first){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+  for(uint8_t i = 0; i < count; i ++){
+    // ttl, segsize, ptr, dest, ackless key, data (the route is empty) 
+    *first = items[i]->data[7];
+    stackClearSlot(items[i]);
+  }
+  return count;
+}
+
+int main(void){
+  uint8_t buf[32];
+  uint8_t first = 0;
+  ep.addRoute(new Route(), EP_ROUTEMODE_ACKLESS);
+  // a new route doesn't tx what was there before it, 
+  ep.loop();
+  CHECK(sent(&first) == 0);
+  // five writes between loops go out as one gram, carrying the last, 
+  for(uint8_t w = 0; w < 5; w ++){
+    fill(buf, 10 * w, 32);
+    ep.write(buf, 32);
+  }
+  CHECK(ep.version == 5);
+  CHECK(ep.data()[0] == 40 && ep.dataLen == 32);
+  ep.loop();
+  CHECK(sent(&first) == 1 && first == 40);
+  CHECK(ep.routes[0]->txVersion == ep.version);
+  // & nothing's fresh after, 
+  ep.loop();
+  CHECK(sent(&first) == 0);
+  // a snapshot holds still while writes land in the other buffer, 
+  uint8_t snap = ep.snapshot();
+  uint8_t held[32];
+  memcpy(held, ep.store[snap], 32);
+  for(uint8_t w = 0; w < 20; w ++){
+    fill(buf, 100 + w, 32);
+    ep.write(buf, 32);
+    CHECK(memcmp(ep.store[snap], held, 32) == 0);
+    CHECK(ep.latest != snap && ep.data()[0] == 100 + w);
+  }
+  // and the next loop's snapshot picks up the latest, 
+  ep.loop();
+  CHECK(sent(&first) == 1 && first == 119);
+  CHECK(ep.reading == ep.latest);
+  return TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+/*
+osap/test/test_scope_batch.cpp
+
+batched scopes: a sweep picks up where the last reply left off 'till every vertex is covered once,
+in order, replies stall when the stack runs short, and records that don't fit are squeezed or skipped
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/packets.h"
+#include <string>
+
+OSAP osap("batch_test");
+Vertex top(&osap, "top");
+
+#define NUM_KIDS 8
+
+// what one reply said,
+struct batchReply {
+  uint16_t ordinal = 0;
+  uint8_t count = 0;
+  uint8_t flags = 0;
+  uint16_t indices[8];
+  std::string names[8];
+};
+
+// sends a batch scope to vt w/ this segSize, from this ordinal, & reads back every reply it makes
+static uint8_t scopeBatch(Vertex* vt, uint8_t mode, uint16_t ordinal, uint16_t segSize, batchReply* replies, uint8_t max){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(segSize, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_SCOPEREQ;
+  gram[wptr ++] = 7;
+  ts_writeUint32(1, gram, &wptr);
+  gram[wptr ++] = mode;
+  ts_writeUint16(ordinal, gram, &wptr);
+  stackLoadSlot(vt, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(vt, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  vt->scopeRequestHandler(items[count - 1], 4);
+  count = stackGetItems(vt, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  uint8_t found = 0;
+  for(uint8_t i = 0; i < count; i ++){
+    // ptr, then <PK_SCOPERES>, <id>, <prevTimeTag u32>, SCOPE_BATCH_RES, mode, ordinal, count, flags, records
+    uint8_t* res = &(items[i]->data[5]);
+    if(items[i]->data[4] != PK_PTR || res[0] != PK_SCOPERES || res[6] != SCOPE_BATCH_RES || found >= max){
+      stackClearSlot(items[i]);
+      continue;
+    }
+    batchReply* reply = &(replies[found ++]);
+    reply->ordinal = ts_readUint16(res, 8);
+    reply->count = res[10];
+    reply->flags = res[11];
+    uint16_t rptr = 12;
+    for(uint8_t r = 0; r < reply->count && r < 8; r ++){
+      // prevTimeTag, type, (plain vertices here), indice, siblings, children, topoVersion, name
+      rptr += 4 + 1;
+      reply->indices[r] = ts_readUint16(res, rptr);
+      rptr += 6 + 4;
+      uint32_t nameLen = ts_readUint32(res, &rptr);
+      reply->names[r] = std::string((const char*)&(res[rptr]), nameLen);
+      rptr += nameLen;
+    }
+    // records run right up to the end of the frame,
+    if(5 + rptr != items[i]->len) reply->flags |= 0x80;
+    stackClearSlot(items[i]);
+  }
+  return found;
+}
+
+static std::string kidName(uint8_t k){
+  return "kid_" + std::to_string(k) + "_padded_to_twenty";
+}
+
+int main(void){
+  Vertex* kids[NUM_KIDS];
+  for(uint8_t k = 0; k < NUM_KIDS; k ++) kids[k] = new Vertex(&top, kidName(k).c_str());
+  batchReply replies[VT_STACKSIZE];
+  // one stack holds VT_STACKSIZE - 1, the request takes one of those,
+  CHECK(VT_STACKSIZE - 1 == 3);
+
+  // ---- a subtree sweep in small replies: each call gets a couple out, the last stalled, & picks up from there
+  // (records here are 19 bytes + the name, so two to a 100 byte reply)
+  std::string seen[NUM_KIDS + 1];
+  uint8_t numSeen = 0;
+  uint16_t next = 0;
+  uint8_t calls = 0;
+  uint8_t ends = 0;
+  boolean consistent = true;
+  while(calls < 20){
+    calls ++;
+    uint8_t got = scopeBatch(&top, SCOPE_MODE_SUBTREE, next, 100, replies, VT_STACKSIZE);
+    if(got == 0){ consistent = false; break; }
+    for(uint8_t r = 0; r < got; r ++){
+      // ordinals run on from one reply to the next,
+      if(replies[r].ordinal != next) consistent = false;
+      if(replies[r].flags & 0x80) consistent = false;
+      for(uint8_t c = 0; c < replies[r].count && numSeen <= NUM_KIDS; c ++) seen[numSeen ++] = replies[r].names[c];
+      next += replies[r].count;
+      if(replies[r].flags & SCOPE_BATCH_END) ends ++;
+      // only the last reply of a call is flagged,
+      if(r + 1 < got && replies[r].flags != 0) consistent = false;
+    }
+    if(replies[got - 1].flags & SCOPE_BATCH_END) break;
+    if(replies[got - 1].flags != SCOPE_BATCH_STALLED) consistent = false;
+    // two replies: the first leaves room, the second is the one that stalls,
+    if(got != 2) consistent = false;
+  }
+  CHECK(consistent);
+  CHECK(ends == 1);
+  CHECK(next == NUM_KIDS + 1 && numSeen == NUM_KIDS + 1);
+  CHECK(seen[0] == "top");
+  boolean inOrder = true;
+  for(uint8_t k = 0; k < NUM_KIDS; k ++) if(seen[k + 1] != kidName(k)) inOrder = false;
+  CHECK(inOrder);
+  // 9 records, 2 to a reply, 2 replies to a call,
+  CHECK(calls == 3);
+
+  // ---- a sibling sweep from the middle starts at that indice
+  uint8_t got = scopeBatch(kids[2], SCOPE_MODE_SIBLINGS, 5, VT_SLOTSIZE, replies, VT_STACKSIZE);
+  CHECK(got == 1);
+  CHECK(replies[0].ordinal == 5 && replies[0].count == 3 && replies[0].flags == SCOPE_BATCH_END);
+  CHECK(replies[0].indices[0] == 5 && replies[0].names[2] == kidName(7));
+
+  // ---- one free slot: the one reply that fits is stalled, & asking again carries on
+  uint8_t junk[8] = { 0 };
+  stackLoadSlot(&top, VT_STACK_DESTINATION, junk, 8);
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, 0, 100, replies, VT_STACKSIZE);
+  CHECK(got == 1);
+  CHECK(replies[0].ordinal == 0 && replies[0].count == 2 && replies[0].flags == SCOPE_BATCH_STALLED);
+  // (the junk went w/ the replies)
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, 2, 100, replies, VT_STACKSIZE);
+  CHECK(got == 2 && replies[0].ordinal == 2 && replies[1].ordinal == 4);
+  // & w/ no room at all, nothing goes out, the request is dropped
+  stackLoadSlot(&top, VT_STACK_DESTINATION, junk, 8);
+  stackLoadSlot(&top, VT_STACK_DESTINATION, junk, 8);
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, 0, 100, replies, VT_STACKSIZE);
+  CHECK(got == 0);
+  stackItem* items[VT_STACKSIZE];
+  CHECK(stackGetItems(&top, VT_STACK_DESTINATION, items, VT_STACKSIZE) == 0);
+
+  // ---- a name too long for the reply is truncated, 1st in its packet, rather than stalling the sweep
+  // 60 bytes is 55 of budget, less 12 of header & 19 of record: 24 chars of name
+  Vertex* longest = new Vertex(&top, "this_one_has_a_name_far_too_long_to_fit_in_a_small_reply");
+  uint16_t longOrdinal = NUM_KIDS + 1;
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, longOrdinal, 60, replies, VT_STACKSIZE);
+  CHECK(got == 1);
+  CHECK(replies[0].ordinal == longOrdinal && replies[0].count == 1 && replies[0].flags == SCOPE_BATCH_END);
+  CHECK(replies[0].indices[0] == longest->indice);
+  CHECK(replies[0].names[0].length() == 24 && std::string(longest->name.c_str()).compare(0, 24, replies[0].names[0]) == 0);
+  // a record that isn't first doesn't get squeezed: it waits for the next packet
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, longOrdinal - 1, 60, replies, VT_STACKSIZE);
+  CHECK(got == 2);
+  CHECK(replies[0].count == 1 && replies[0].names[0] == kidName(NUM_KIDS - 1) && replies[0].flags == 0);
+  CHECK(replies[1].ordinal == longOrdinal && replies[1].count == 1 && replies[1].flags == SCOPE_BATCH_END);
+
+  // ---- a segSize too small for any record gets one empty, last reply, as does a start past the end
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, 0, 24, replies, VT_STACKSIZE);
+  CHECK(got == 1 && replies[0].count == 0 && replies[0].flags == SCOPE_BATCH_END);
+  got = scopeBatch(&top, SCOPE_MODE_SUBTREE, 100, VT_SLOTSIZE, replies, VT_STACKSIZE);
+  CHECK(got == 1 && replies[0].ordinal == 100 && replies[0].count == 0 && replies[0].flags == SCOPE_BATCH_END);
+  return TEST_RESULT();
+}
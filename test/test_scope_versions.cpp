@@ -0,0 +1,77 @@
+/*
+osap/test/test_scope_versions.cpp
+
+conditional scopes: not-modified 'till something the request covers has changed 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/packets.h"
+
+OSAP osap("scope_test");
+Vertex a(&osap, "a");
+Vertex b(&osap, "b");
+
+// sends a conditional scope to vt, returns the byte where the vertex type would be in the reply 
+// (SCOPE_NOT_MODIFIED, SCOPE_BATCH_RES, or the type) & the version a not-modified carried 
+static uint8_t scopeIfNewer(Vertex* vt, uint8_t mode, uint32_t since, uint32_t* version){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_SCOPEREQ;
+  gram[wptr ++] = 9;
+  ts_writeUint32(1, gram, &wptr);
+  gram[wptr ++] = mode | SCOPE_IF_NEWER;
+  ts_writeUint16(0, gram, &wptr);
+  ts_writeUint32(since, gram, &wptr);
+  stackLoadSlot(vt, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(vt, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  vt->scopeRequestHandler(items[count - 1], 4);
+  count = stackGetItems(vt, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  if(count == 0) return 0;
+  // ptr, then <PK_SCOPERES>, <id>, <prevTimeTag u32>, & the type / not-modified byte 
+  uint8_t* res = &(items[0]->data[5]);
+  uint8_t what = res[6];
+  uint16_t rptr = 7;
+  if(what == SCOPE_NOT_MODIFIED) *version = ts_readUint32(res, &rptr);
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+  return what;
+}
+
+int main(void){
+  uint32_t version = 0;
+  uint32_t rootSince = osap.topoVersion;
+  uint32_t aSince = a.topoVersion;
+  // nothing's moved, 
+  CHECK(scopeIfNewer(&a, SCOPE_MODE_SIBLINGS, rootSince, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(version == osap.topoVersion);
+  CHECK(scopeIfNewer(&a, SCOPE_MODE_SELF, aSince, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(version == aSince);
+  // then a's sibling grows a child: a itself hasn't changed, but its siblings have, 
+  Vertex bc(&b, "bc");
+  CHECK(a.topoVersion == aSince);
+  CHECK(scopeIfNewer(&a, SCOPE_MODE_SELF, aSince, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(scopeIfNewer(&a, SCOPE_MODE_SIBLINGS, rootSince, &version) == SCOPE_BATCH_RES);
+  // & against the new version, the sweep's unchanged again, 
+  CHECK(scopeIfNewer(&b, SCOPE_MODE_SIBLINGS, osap.topoVersion, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(version == osap.topoVersion);
+  // the root has no parent, so its sibling sweep (just itself) goes by its own version 
+  CHECK(scopeIfNewer(&osap, SCOPE_MODE_SIBLINGS, rootSince, &version) == SCOPE_BATCH_RES);
+  CHECK(scopeIfNewer(&osap, SCOPE_MODE_SIBLINGS, osap.topoVersion, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(version == osap.topoVersion);
+  // a sibling sweep from the new leaf goes by b's version, which moved when bc was added 
+  CHECK(scopeIfNewer(&bc, SCOPE_MODE_SIBLINGS, b.topoVersion, &version) == SCOPE_NOT_MODIFIED);
+  CHECK(version == b.topoVersion);
+  return TEST_RESULT();
+}
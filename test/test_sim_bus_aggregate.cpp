@@ -0,0 +1,58 @@
+/*
+osap/test/test_sim_bus_aggregate.cpp
+
+sim bus drops only take aggregates off the wire once all of their datagrams fit 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/sim_links.h"
+
+SimClock simClock;
+SimBusMedium medium(&simClock, SimLinkParams());
+
+OSAP osap("sim_agg_test");
+VBusSim head(&osap, "head", &medium, 0);
+VBusSim drop(&osap, "drop", &medium, 1);
+
+uint8_t dg[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+static uint8_t originCount(Vertex* vt){
+  stackItem* items[VT_STACKSIZE];
+  return stackGetItems(vt, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+}
+
+int main(void){
+  head.setAggregation(128, 1000000);
+  drop.setAggregation(128, 1000000);
+  // drop's stack has room for one more, 
+  stackItem* slots[VT_STACKSIZE];
+  while(stackReserveSlots(&drop, VT_STACK_ORIGIN, slots, VT_STACKSIZE) > 1) stackLoadSlot(&drop, VT_STACK_ORIGIN, dg, 16);
+  uint8_t before = originCount(&drop);
+  // three datagrams go out as one frame, 
+  for(uint8_t d = 0; d < 3; d ++){
+    CHECK(head.clearToForward(1, 16, false));
+    head.forward(dg, 16, 1, false);
+  }
+  CHECK(head.flushAggregate());
+  CHECK(drop.rxQueue.count == 1);
+  simClock.advance(10000);
+  // it waits on the wire, w/ nothing lost, 
+  drop.loop();
+  CHECK(drop.rxQueue.count == 1);
+  CHECK(originCount(&drop) == before);
+  // 'till there's room for all of it 
+  stackReset(&drop);
+  drop.loop();
+  CHECK(drop.rxQueue.count == 0);
+  CHECK(originCount(&drop) == 3);
+  return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+/*
+osap/test/test_sim_links.cpp
+
+sim links: drops waiting on a busy bus line are tallied as contention, and ports / drops
+that go away take themselves off the wire
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/sim_links.h"
+#include <optional>
+
+SimClock simClock;
+// 1 Mbit, so a byte is 8us on the line,
+SimBusMedium medium(&simClock, SimLinkParams());
+
+OSAP osap("sim_links_test");
+VBusSim first(&osap, "first", &medium, 0);
+VBusSim second(&osap, "second", &medium, 1);
+VBusSim third(&osap, "third", &medium, 2);
+
+uint8_t frame[100] = { 0 };
+
+int main(void){
+  // ---- one drop has the line, another waits for it,
+  CHECK(first.cts(2));
+  first.send(frame, 100, 2);
+  CHECK(medium.lineFreeAt == 800);
+  CHECK(!second.cts(2));
+  simClock.advance(300);
+  CHECK(!second.ctb(0));
+  CHECK(medium.contendedMicros == 0);
+  // & the wait is counted up to when the line went free, not when we looked again,
+  simClock.advance(600);
+  CHECK(second.cts(2));
+  CHECK(medium.contendedMicros == 800);
+  second.send(frame, 100, 2);
+  // no double counting: the send found the line free,
+  CHECK(medium.contendedMicros == 800);
+  CHECK(medium.lineFreeAt == 900 + 800);
+  // broadcasts wait the same way,
+  simClock.advance(100);
+  CHECK(!third.ctb(0));
+  simClock.advance(800);
+  CHECK(third.ctb(0));
+  CHECK(medium.contendedMicros == 800 + 700);
+  // a drop that's never refused never counts,
+  simClock.advance(10000);
+  CHECK(first.cts(1));
+  CHECK(medium.contendedMicros == 800 + 700);
+
+  // ---- a drop that goes away detaches, & its addr can be taken again
+  {
+    std::optional<VBusSim> gone;
+    gone.emplace(&osap, "gone", &medium, 5);
+    CHECK(medium.drops[5] == &(*gone));
+    CHECK(first.isOpen(5));
+    gone.reset();
+    CHECK(medium.drops[5] == nullptr);
+    CHECK(!first.isOpen(5) && !first.cts(5));
+    gone.emplace(&osap, "again", &medium, 5);
+    CHECK(medium.drops[5] == &(*gone));
+    CHECK(first.isOpen(5));
+    // one that never got an addr doesn't take anyone else's w/ it,
+    std::optional<VBusSim> dup;
+    dup.emplace(&osap, "dup", &medium, 5);
+    dup.reset();
+    CHECK(medium.drops[5] == &(*gone));
+  }
+  CHECK(medium.drops[5] == nullptr);
+
+  // ---- a port that goes away disconnects its peer
+  SimLinkParams params;
+  std::optional<VPortSim> a, b;
+  a.emplace(&osap, "a", &simClock, params);
+  b.emplace(&osap, "b", &simClock, params);
+  VPortSim::connect(&(*a), &(*b));
+  CHECK(a->isOpen() && b->isOpen());
+  a.reset();
+  CHECK(!b->isOpen() && !b->cts());
+  CHECK(b->peer == nullptr);
+  return TEST_RESULT();
+}
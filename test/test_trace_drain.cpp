@@ -0,0 +1,75 @@
+/*
+osap/test/test_trace_drain.cpp
+
+the trace sink stays off the hot path: while the loop has items it's drained once per interval,
+on idle passes every time, and hosts can drain it themselves
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+
+OSAP osap("drain_test");
+Vertex vt(&osap, "vt");
+
+unsigned long nowMicros = 0;
+static unsigned long fakeMicros(void){ return nowMicros; }
+
+uint16_t sunk = 0;
+static void countingSink(traceRecord*){ sunk ++; }
+
+static void writeRecords(uint16_t count){
+  for(uint16_t r = 0; r < count; r ++) OSAP::trace(TRACE_GENERIC_DEST, MINOR, &vt, r);
+}
+
+int main(void){
+  shimSetClock(fakeMicros);
+  OSAP::traceSink_cb = countingSink;
+  CHECK(OSAP_TRACE_DRAIN_PER_LOOP == 4);
+
+  // ---- an item the loop sees each pass, but leaves alone, keeps it busy
+  uint8_t gram[8] = { 0 };
+  stackLoadSlot(&vt, VT_STACK_ORIGIN, gram, 8);
+  stackItem* items[VT_STACKSIZE];
+  CHECK(stackGetItems(&vt, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1);
+  items[0]->borrowed = true;
+  writeRecords(10);
+  // busy passes inside the interval don't touch the sink,
+  for(uint8_t l = 0; l < 5; l ++){
+    nowMicros += 1000;
+    osap.loop();
+  }
+  CHECK(sunk == 0);
+  // once it's up, one batch goes out, & then we wait again,
+  nowMicros = OSAP_TRACE_DRAIN_INTERVAL_MS * 1000;
+  osap.loop();
+  CHECK(sunk == 4);
+  nowMicros += 1000;
+  osap.loop();
+  CHECK(sunk == 4);
+
+  // ---- idle passes drain every time, a batch at a time
+  stackClearSlot(items[0]);
+  osap.loop();
+  CHECK(sunk == 8);
+  osap.loop();
+  CHECK(sunk == 10);
+  osap.loop();
+  CHECK(sunk == 10);
+
+  // ---- & hosts can drain on their own, as many as they ask for
+  writeRecords(9);
+  CHECK(OSAP::drainTrace(6) == 6);
+  CHECK(sunk == 16);
+  CHECK(OSAP::drainTrace(100) == 3);
+  CHECK(sunk == 19);
+  CHECK(OSAP::drainTrace(100) == 0);
+  return TEST_RESULT();
+}
@@ -0,0 +1,53 @@
+/*
+osap/test/test_trace_filter.cpp
+
+filtered-out OSAP_ERROR / OSAP_DEBUG calls go away at the call site: their args are never evaluated
+and nothing lands in the trace ring, while the ones that are kept still record
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+// only HALTING errors, and only the DEFAULT debug stream, (set before the include, as a build would)
+#define OSAP_TRACE_LEVEL 0
+#define OSAP_TRACE_STREAMS (1 << 0)
+
+#include "test.h"
+#include "../core/osap.h"
+
+OSAP osap("filter_test");
+
+uint32_t evaluated = 0;
+static uint32_t sideEffect(void){ return ++ evaluated; }
+
+int main(void){
+  // the filter is a constant at each call site,
+  static_assert(!(MINOR <= OSAP_TRACE_LEVEL), "MINOR should be filtered here");
+  static_assert(!(OSAP_TRACE_STREAMS & (1 << LOOP)), "LOOP should be filtered here");
+  traceRecord recs[OSAP_TRACE_RING_SIZE];
+  traceRead(recs, OSAP_TRACE_RING_SIZE);
+
+  // ---- filtered levels & streams: no args evaluated, nothing recorded
+  for(uint8_t i = 0; i < 8; i ++){
+    OSAP_ERROR(TRACE_GENERIC_DEST, MINOR, &osap, sideEffect(), sideEffect());
+    OSAP_ERROR(TRACE_GENERIC_DEST, MEDIUM, &osap, sideEffect());
+    OSAP_DEBUG(TRACE_TTL_DROP, LOOP, &osap, sideEffect(), sideEffect());
+  }
+  CHECK(evaluated == 0);
+  CHECK(traceRead(recs, OSAP_TRACE_RING_SIZE) == 0);
+
+  // ---- kept ones evaluate their args once each, & record
+  OSAP_ERROR(TRACE_GENERIC_DEST, HALTING, &osap, sideEffect(), sideEffect());
+  OSAP_DEBUG(TRACE_TTL_DROP, DEFAULT, &osap, sideEffect());
+  CHECK(evaluated == 3);
+  CHECK(traceRead(recs, OSAP_TRACE_RING_SIZE) == 2);
+  // (in either order, args are unsequenced)
+  CHECK(recs[0].event == TRACE_GENERIC_DEST && recs[0].args[0] + recs[0].args[1] == 3);
+  CHECK(recs[1].event == TRACE_TTL_DROP && recs[1].args[0] == 3);
+  return TEST_RESULT();
+}
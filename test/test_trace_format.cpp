@@ -0,0 +1,53 @@
+/*
+osap/test/test_trace_format.cpp
+
+trace records render into any size of buffer w/o running past it 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/trace.h"
+
+#define GUARD 64 
+
+// formats into exactly maxLen bytes of a poisoned buffer, true if it stayed inside & terminated 
+static boolean fits(const traceRecord* rec, uint16_t maxLen){
+  char buf[128 + GUARD];
+  memset(buf, 0x7e, sizeof(buf));
+  uint16_t len = traceFormat(rec, buf, maxLen);
+  if(maxLen == 0) return len == 0 && buf[0] == 0x7e;
+  if(len >= maxLen || buf[len] != 0 || strlen(buf) != len) return false;
+  for(uint16_t i = maxLen; i < sizeof(buf); i ++){
+    if(buf[i] != 0x7e) return false;
+  }
+  return true;
+}
+
+int main(void){
+  traceRecord rec;
+  rec.seq = 1;
+  rec.time = 0;
+  rec.vtIndice = 65535;
+  rec.level = 0;
+  rec.args[0] = 4000000000u;
+  rec.args[1] = 4000000000u;
+  // every event's format, & one past the table (which falls back to raw args), 
+  // at every buffer size from nothing to roomy, incl. ones the header alone overflows 
+  for(uint16_t event = 0; event <= TRACE_NUM_EVENTS; event ++){
+    rec.event = event;
+    for(uint16_t maxLen = 0; maxLen <= 128; maxLen ++){
+      if(!fits(&rec, maxLen)){
+        CHECK(false);
+        fprintf(stderr, "  event %u, maxLen %u\n", event, maxLen);
+      }
+    }
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+/*
+osap/test/test_typed_endpoint.cpp
+
+typed endpoints pack to their declared layout, and only take frames of exactly that size 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/typed_endpoint.h"
+
+struct __attribute__((packed)) motorState {
+  float pos;
+  uint16_t flags;
+  uint32_t tick;
+  static constexpr uint8_t wireLayout[] = { 4, 2, 4 };
+};
+
+OSAP osap("typed_test");
+motorState lastRx;
+uint32_t rxCount = 0;
+
+EP_ONDATA_RESPONSES onState(const motorState& val){
+  lastRx = val;
+  rxCount ++;
+  return EP_ONDATA_ACCEPT;
+}
+
+TypedEndpoint<motorState> ep(&osap, "state", onState);
+
+// an ackless frame of len bytes, straight to the endpoint, 
+static void deliver(uint8_t* frame, uint16_t len){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  gram[wptr ++] = EP_SS_ACKLESS;
+  memcpy(&(gram[wptr]), frame, len);
+  wptr += len;
+  stackLoadSlot(&ep, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&ep, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  ep.destHandler(items[count - 1], 4);
+}
+
+int main(void){
+  CHECK(TypedEndpoint<motorState>::wireSize == 10);
+  motorState st = { 1.5f, 0x0102, 0x03040506 };
+  uint8_t buf[16];
+  TypedEndpoint<motorState>::pack(st, buf);
+  // the wire is little-endian, field by field, 
+  CHECK(buf[4] == 0x02 && buf[5] == 0x01);
+  CHECK(buf[6] == 0x06 && buf[9] == 0x03);
+  motorState back;
+  CHECK(TypedEndpoint<motorState>::unpack(buf, 10, &back));
+  CHECK(back.pos == 1.5f && back.flags == 0x0102 && back.tick == 0x03040506);
+  // the big-endian path swaps each field, and is its own inverse, 
+  uint8_t swapped[16], again[16];
+  TypedEndpoint<motorState>::swapFields(swapped, buf);
+  CHECK(swapped[0] == buf[3] && swapped[4] == buf[5] && swapped[6] == buf[9]);
+  TypedEndpoint<motorState>::swapFields(again, swapped);
+  CHECK(memcmp(again, buf, 10) == 0);
+  // short & long frames are both refused, 
+  CHECK(!TypedEndpoint<motorState>::unpack(buf, 9, &back));
+  CHECK(!TypedEndpoint<motorState>::unpack(buf, 11, &back));
+  deliver(buf, 11);
+  CHECK(rxCount == 0);
+  deliver(buf, 9);
+  CHECK(rxCount == 0);
+  deliver(buf, 10);
+  CHECK(rxCount == 1 && lastRx.tick == 0x03040506);
+  // and typed writes read back, 
+  motorState next = { -2.0f, 7, 99 };
+  ep.write(next);
+  CHECK(ep.read().tick == 99 && ep.read().pos == -2.0f);
+  return TEST_RESULT();
+}
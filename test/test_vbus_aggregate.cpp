@@ -0,0 +1,115 @@
+/*
+osap/test/test_vbus_aggregate.cpp
+
+bus aggregation: a stalled drop only holds up itself, wide rx addrs survive, rx is all-or-nothing 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+
+// records what goes out, w/ a per-drop clear-to-send, 
+class TestBus : public VBus {
+  public:
+    boolean blocked[512] = { false };
+    uint8_t lastFrame[VBUS_AGG_BUFSIZE];
+    uint16_t lastLen = 0;
+    uint16_t lastAddr = 0;
+    uint32_t sends = 0;
+    void send(uint8_t* data, uint16_t len, uint16_t rxAddr) override {
+      memcpy(lastFrame, data, len);
+      lastLen = len;
+      lastAddr = rxAddr;
+      sends ++;
+    }
+    void broadcast(uint8_t*, uint16_t, uint16_t) override {}
+    boolean cts(uint16_t rxAddr) override { return !blocked[rxAddr]; }
+    boolean ctb(uint16_t) override { return true; }
+    boolean isOpen(uint16_t) override { return true; }
+    TestBus(Vertex* _parent, String _name) : VBus(_parent, _name){};
+};
+
+OSAP osap("aggregate_test");
+TestBus bus(&osap, "bus");
+TestBus rx(&osap, "rx");
+
+uint8_t dg[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+static uint8_t originCount(Vertex* vt){
+  stackItem* items[VT_STACKSIZE];
+  return stackGetItems(vt, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+}
+
+int main(void){
+  // ---- a held aggregate for a stalled drop doesn't block the others 
+  bus.setAggregation(128, 1000000);
+  CHECK(bus.clearToForward(3, 16, false));
+  bus.forward(dg, 16, 3, false);
+  CHECK(bus.sends == 0);
+  bus.blocked[3] = true;
+  // drop 3 is stuck, but drop 5 gets its own aggregate, 
+  CHECK(bus.clearToForward(5, 16, false));
+  bus.forward(dg, 16, 5, false);
+  CHECK(bus.sends == 0);
+  // & a stalled drop that has nothing held is refused, w/o taking a slot, 
+  bus.blocked[6] = true;
+  CHECK(!bus.clearToForward(6, 16, false));
+  // w/ both slots held for drops that won't go, drop 7 still goes, on its own 
+  bus.blocked[5] = true;
+  CHECK(bus.clearToForward(7, 16, false));
+  bus.forward(dg, 16, 7, false);
+  CHECK(bus.sends == 1 && bus.lastAddr == 7);
+  CHECK(bus.lastFrame[0] == VBUS_AGG_UNICAST && ts_readUint16(bus.lastFrame, 1) == 7);
+  CHECK(bus.lastLen == VBUS_AGG_HEADER + 2 + 16);
+  // & drop 3 drains once it unblocks 
+  bus.blocked[3] = false;
+  CHECK(!bus.flushAggregate());
+  CHECK(bus.sends == 2 && bus.lastAddr == 3);
+  bus.blocked[5] = false;
+  CHECK(bus.flushAggregate());
+  CHECK(bus.sends == 3 && bus.lastAddr == 5);
+
+  // ---- rx addrs past 255 are carried whole in the header 
+  bus.setAggregation(128, 0);
+  CHECK(bus.clearToForward(300, 16, false));
+  bus.forward(dg, 16, 300, false);
+  CHECK(bus.sends == 4);
+  CHECK(ts_readUint16(bus.lastFrame, 1) == 300);
+
+  // ---- rx'd aggregates go in whole, or not at all 
+  uint8_t frame[VBUS_AGG_BUFSIZE];
+  uint16_t wptr = 0;
+  frame[wptr ++] = VBUS_AGG_UNICAST;
+  ts_writeUint16(300, frame, &wptr);
+  for(uint8_t d = 0; d < 3; d ++){
+    ts_writeUint16(16, frame, &wptr);
+    memcpy(&(frame[wptr]), dg, 16);
+    wptr += 16;
+  }
+  rx.setAggregation(128, 0);
+  rx.ownRxAddr = 300;
+  CHECK(rx.aggregateFits(frame, wptr));
+  // fill the origin stack 'till three won't fit, 
+  while(rx.aggregateFits(frame, wptr)) stackLoadSlot(&rx, VT_STACK_ORIGIN, dg, 16);
+  uint8_t before = originCount(&rx);
+  CHECK(before > 0);
+  CHECK(rx.unpackAggregate(frame, wptr) == 0);
+  CHECK(originCount(&rx) == before);
+  // & w/ room, all three land 
+  stackReset(&rx);
+  CHECK(rx.unpackAggregate(frame, wptr) == 3);
+  CHECK(originCount(&rx) == 3);
+  // ---- and only at the drop they're for: 300 isn't 44, tho they share a low byte 
+  stackReset(&rx);
+  rx.ownRxAddr = 44;
+  CHECK(rx.unpackAggregate(frame, wptr) == 0);
+  CHECK(originCount(&rx) == 0);
+  return TEST_RESULT();
+}
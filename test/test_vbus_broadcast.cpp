@@ -0,0 +1,135 @@
+/*
+osap/test/test_vbus_broadcast.cpp
+
+broadcast fan-out: each subscriber gets the rx'd frame w/ its route spliced in, in its own slot,
+in order, and slots reserved while others are cleared out from under them still land in order
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/packets.h"
+
+class TestBus : public VBus {
+  public:
+    void send(uint8_t*, uint16_t, uint16_t) override {}
+    void broadcast(uint8_t*, uint16_t, uint16_t) override {}
+    boolean cts(uint16_t) override { return true; }
+    boolean ctb(uint16_t) override { return true; }
+    boolean isOpen(uint16_t) override { return true; }
+    TestBus(Vertex* _parent, String _name) : VBus(_parent, _name){};
+};
+
+OSAP osap("broadcast_test");
+TestBus bus(&osap, "bus");
+
+#define CHANNEL 7
+
+// as rx'd: ttl, segsize, <bbrd, txAddr>, PTR, <payload>
+uint8_t frame[32];
+uint16_t frameLen = 0;
+uint16_t framePtr = 0;
+
+static void buildFrame(uint8_t fill){
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, frame, &wptr);
+  ts_writeUint16(128, frame, &wptr);
+  writeKeyArgPair(frame, wptr, PK_BBRD, 3);
+  wptr += 2;
+  framePtr = wptr;
+  frame[wptr ++] = PK_PTR;
+  frame[wptr ++] = PK_DEST;
+  for(uint8_t i = 0; i < 8; i ++) frame[wptr ++] = fill + i;
+  frameLen = wptr;
+}
+
+// the frame w/ this route spliced in just after its ptr,
+static boolean spliced(stackItem* item, Route* route){
+  if(item->len != frameLen + route->pathLen - 1) return false;
+  if(memcmp(item->data, frame, framePtr + 1) != 0) return false;
+  if(memcmp(&(item->data[framePtr + 1]), &(route->path[1]), route->pathLen - 1) != 0) return false;
+  return memcmp(&(item->data[framePtr + route->pathLen]), &(frame[framePtr + 1]), frameLen - framePtr - 1) == 0;
+}
+
+static void clearAll(void){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+  for(uint8_t i = 0; i < count; i ++) stackClearSlot(items[i]);
+}
+
+int main(void){
+  stackItem* items[VT_STACKSIZE];
+  Route* subs[3] = {
+    (new Route())->sib(1),
+    (new Route())->sib(2)->pfwd(),
+    (new Route())->sib(0)->bfwd(300)
+  };
+  for(uint8_t s = 0; s < 3; s ++) CHECK(bus.addBroadcastSubscriber(CHANNEL, subs[s]) == s);
+  // one stack holds VT_STACKSIZE - 1,
+  CHECK(VT_STACKSIZE - 1 == 3);
+
+  // ---- fan-out: one slot per subscriber, in subscriber order
+  buildFrame(0x10);
+  CHECK(bus.injestBroadcastPacket(frame, frameLen, CHANNEL));
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  for(uint8_t s = 0; s < 3; s ++) CHECK(spliced(items[s], subs[s]));
+  // full: nothing goes in, the rest of a batch is dropped,
+  uint8_t* frames[2] = { frame, frame };
+  uint16_t lens[2] = { frameLen, frameLen };
+  uint8_t channels[2] = { CHANNEL, CHANNEL };
+  CHECK(bus.injestBroadcastPackets(frames, lens, channels, 2) == 0);
+  // part-full: the subscribers that fit get it, the others don't,
+  stackClearSlot(items[0]);
+  stackClearSlot(items[1]);
+  buildFrame(0x20);
+  CHECK(bus.injestBroadcastPacket(frame, frameLen, CHANNEL));
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  CHECK(spliced(items[1], subs[0]));
+  CHECK(spliced(items[2], subs[1]));
+  clearAll();
+
+  // ---- a slot's reserved, then one that isn't the head is cleared: firstFree moves back past the reservation,
+  uint8_t head[4] = { 1, 1, 1, 1 };
+  uint8_t mid[4] = { 2, 2, 2, 2 };
+  stackLoadSlot(&bus, VT_STACK_ORIGIN, head, 4);
+  stackLoadSlot(&bus, VT_STACK_ORIGIN, mid, 4);
+  stackItem* reserved[2];
+  CHECK(stackReserveSlots(&bus, VT_STACK_ORIGIN, reserved, 2) == 1);
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  stackClearSlot(items[1]);
+  CHECK(bus.firstFree[VT_STACK_ORIGIN] != reserved[0]);
+  // committing re-links it, so it lands just behind the head,
+  memset(reserved[0]->data, 3, 4);
+  stackCommitSlot(reserved[0], 4);
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  CHECK(items[0]->len == 4 && items[0]->data[0] == 1);
+  CHECK(items[1] == reserved[0] && items[1]->data[0] == 3);
+  // & a fan-out into what's left goes in after it, as far as it fits,
+  buildFrame(0x30);
+  CHECK(bus.injestBroadcastPacket(frame, frameLen, CHANNEL));
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  CHECK(items[0]->data[0] == 1 && items[1]->data[0] == 3);
+  CHECK(spliced(items[2], subs[0]));
+  // the ring is still whole: once the head goes, the next fan-out fills in behind,
+  stackClearSlot(items[0]);
+  buildFrame(0x40);
+  CHECK(bus.injestBroadcastPacket(frame, frameLen, CHANNEL));
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  CHECK(items[0]->data[0] == 3);
+  CHECK(items[1]->data[framePtr + subs[0]->pathLen] == PK_DEST && items[1]->data[framePtr + subs[0]->pathLen + 1] == 0x30);
+  CHECK(spliced(items[2], subs[0]));
+  clearAll();
+  CHECK(stackReserveSlots(&bus, VT_STACK_ORIGIN, reserved, 2) == 2);
+  // and a clean slate fans out to all three again,
+  CHECK(bus.injestBroadcastPacket(frame, frameLen, CHANNEL));
+  CHECK(stackGetItems(&bus, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  for(uint8_t s = 0; s < 3; s ++) CHECK(spliced(items[s], subs[s]));
+  return TEST_RESULT();
+}
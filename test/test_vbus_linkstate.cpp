@@ -0,0 +1,86 @@
+/*
+osap/test/test_vbus_linkstate.cpp
+
+link-state maps serialize lsb-first, and deltas don't miss changes across > 64k edges 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/packets.h"
+
+// a bus that only keeps its link-state map, 
+class TestBus : public VBus {
+  public:
+    void send(uint8_t*, uint16_t, uint16_t) override {}
+    void broadcast(uint8_t*, uint16_t, uint16_t) override {}
+    boolean cts(uint16_t) override { return true; }
+    boolean ctb(uint16_t) override { return true; }
+    boolean isOpen(uint16_t) override { return false; }
+    TestBus(Vertex* _parent, String _name) : VBus(_parent, _name){};
+};
+
+OSAP osap("linkstate_test");
+TestBus bus(&osap, "bus");
+
+// asks for the words changed since an epoch, returns the # of words in the reply & whether word w was one 
+static uint8_t deltaSince(uint32_t since, uint16_t w, boolean* sawWord){
+  uint8_t gram[VT_SLOTSIZE];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(VT_SLOTSIZE, gram, &wptr);
+  gram[wptr ++] = PK_PTR;
+  gram[wptr ++] = PK_DEST;
+  gram[wptr ++] = VBUS_LINKSTATE_DELTA_REQ;
+  gram[wptr ++] = 7;
+  ts_writeUint32(since, gram, &wptr);
+  stackLoadSlot(&bus, VT_STACK_DESTINATION, gram, wptr);
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&bus, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  bus.destHandler(items[count - 1], 4);
+  count = stackGetItems(&bus, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  if(count != 1) return 0;
+  // ptr, dest, key, id, epoch u32, complete, count, <word u16, bits u32> 
+  uint8_t* res = &(items[0]->data[5]);
+  uint8_t words = res[8];
+  *sawWord = false;
+  for(uint8_t i = 0; i < words; i ++){
+    if(ts_readUint16(res, 9 + i * 6) == w) *sawWord = true;
+  }
+  stackClearSlot(items[0]);
+  return words;
+}
+
+int main(void){
+  bus.addrSpaceSize = 64;
+  bus.setLinkState(0, true);
+  bus.setLinkState(9, true);
+  bus.setLinkState(33, true);
+  // addr 0 is the lsb of byte 0, 
+  uint8_t map[8];
+  CHECK(bus.writeLinkState(map, 8) == 8);
+  CHECK(map[0] == 0x01 && map[1] == 0x02 && map[4] == 0x02);
+  CHECK(map[2] == 0 && map[3] == 0 && map[5] == 0);
+  // a mapper last looked here, 
+  uint32_t since = bus.linkStateEpoch;
+  // then word 1 flaps a lot, 
+  for(uint32_t e = 0; e < 40000; e ++) bus.setLinkState(40, (e & 1) == 0);
+  // and word 0 changes once, 
+  bus.setLinkState(3, true);
+  // then word 1 flaps past a 16-bit epoch's reach, 
+  for(uint32_t e = 0; e < 40000; e ++) bus.setLinkState(40, (e & 1) == 0);
+  CHECK(bus.linkStateEpoch - since > 65536);
+  boolean sawWord0 = false;
+  CHECK(deltaSince(since, 0, &sawWord0) == 2);
+  CHECK(sawWord0);
+  // & nothing's changed since now, 
+  CHECK(deltaSince(bus.linkStateEpoch, 0, &sawWord0) == 0);
+  return TEST_RESULT();
+}
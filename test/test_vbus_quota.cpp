@@ -0,0 +1,127 @@
+/*
+osap/test/test_vbus_quota.cpp
+
+bus drop quotas & round-robin: a busy drop only fills its own share of the bus' stack,
+a quiet drop keeps going past it, and ready drops are served in turn
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../core/packets.h"
+
+// records which drop each frame went to, w/ a per-drop clear-to-send,
+class TestBus : public VBus {
+  public:
+    boolean blocked[8] = { false };
+    uint16_t sentTo[256];
+    uint16_t sends = 0;
+    void send(uint8_t*, uint16_t, uint16_t rxAddr) override {
+      if(sends < 256) sentTo[sends] = rxAddr;
+      sends ++;
+    }
+    void broadcast(uint8_t*, uint16_t, uint16_t) override {}
+    boolean cts(uint16_t rxAddr) override { return !blocked[rxAddr]; }
+    boolean ctb(uint16_t) override { return true; }
+    boolean isOpen(uint16_t) override { return true; }
+    TestBus(Vertex* _parent, String _name) : VBus(_parent, _name){};
+};
+
+OSAP osap("quota_test");
+TestBus bus(&osap, "bus");
+Vertex busySrc(&osap, "busy");
+Vertex quietSrc(&osap, "quiet");
+
+#define BUSY_DROP 1
+#define QUIET_DROP 2
+
+// tops up a source's origin stack w/ frames for this drop, via the bus (sibling 0)
+static void fill(Vertex* src, uint16_t rxAddr){
+  Route* route = (new Route())->sib(0)->bfwd(rxAddr);
+  uint8_t gram[64];
+  uint16_t wptr = 0;
+  ts_writeUint16(1000, gram, &wptr);
+  ts_writeUint16(128, gram, &wptr);
+  memcpy(&(gram[wptr]), route->path, route->pathLen);
+  wptr += route->pathLen;
+  gram[wptr ++] = 77;
+  delete route;
+  while(stackEmptySlot(src, VT_STACK_ORIGIN)) stackLoadSlot(src, VT_STACK_ORIGIN, gram, wptr);
+}
+
+// what queuedFor() should say, the slow way
+static uint8_t scanFor(uint16_t rxAddr){
+  stackItem* items[VT_STACKSIZE];
+  uint8_t count = stackGetItems(&bus, VT_STACK_DESTINATION, items, VT_STACKSIZE);
+  uint8_t queued = 0;
+  uint16_t ptr = 0;
+  for(uint8_t i = 0; i < count; i ++){
+    if(!findPtr(items[i]->data, &ptr)) continue;
+    if(PK_READKEY(items[i]->data[ptr + 1]) == PK_BFWD && readArg(items[i]->data, ptr + 1) == rxAddr) queued ++;
+  }
+  return queued;
+}
+
+static uint16_t sendsTo(uint16_t rxAddr, uint16_t from){
+  uint16_t n = 0;
+  for(uint16_t s = from; s < bus.sends && s < 256; s ++) if(bus.sentTo[s] == rxAddr) n ++;
+  return n;
+}
+
+int main(void){
+  // ---- the busy drop is stalled: it holds its quota of the bus' stack & no more, the quiet one keeps moving
+  bus.blocked[BUSY_DROP] = true;
+  boolean countsMatch = true;
+  boolean underQuota = true;
+  for(uint8_t l = 0; l < 40; l ++){
+    fill(&busySrc, BUSY_DROP);
+    fill(&quietSrc, QUIET_DROP);
+    osap.loop();
+    if(bus.queuedFor(BUSY_DROP) != scanFor(BUSY_DROP)) countsMatch = false;
+    if(bus.queuedFor(QUIET_DROP) != scanFor(QUIET_DROP)) countsMatch = false;
+    if(bus.queuedFor(BUSY_DROP) > bus.dropQuota) underQuota = false;
+  }
+  CHECK(countsMatch);
+  CHECK(underQuota);
+  CHECK(bus.queuedFor(BUSY_DROP) == bus.dropQuota);
+  CHECK(sendsTo(BUSY_DROP, 0) == 0);
+  // roughly a frame per loop, once the pipe is full,
+  CHECK(sendsTo(QUIET_DROP, 0) >= 30);
+
+  // ---- once it clears, both are ready & they take turns
+  bus.blocked[BUSY_DROP] = false;
+  uint16_t start = bus.sends;
+  for(uint8_t l = 0; l < 40; l ++){
+    fill(&busySrc, BUSY_DROP);
+    fill(&quietSrc, QUIET_DROP);
+    osap.loop();
+    if(bus.queuedFor(BUSY_DROP) != scanFor(BUSY_DROP)) countsMatch = false;
+    if(bus.queuedFor(QUIET_DROP) != scanFor(QUIET_DROP)) countsMatch = false;
+  }
+  CHECK(countsMatch);
+  CHECK(bus.sends - start >= 40);
+  // when one pass sends > 1 frame, it's to both drops in turn, and neither gets more than its share
+  uint16_t busy = sendsTo(BUSY_DROP, start);
+  uint16_t quiet = sendsTo(QUIET_DROP, start);
+  CHECK(busy + 1 >= quiet && quiet + 1 >= busy);
+  uint16_t repeats = 0;
+  for(uint16_t s = start + 1; s < bus.sends && s < 256; s ++) if(bus.sentTo[s] == bus.sentTo[s - 1]) repeats ++;
+  CHECK(repeats == 0);
+
+  // ---- & w/ nothing new coming in, everything drains & every counter comes back
+  for(uint8_t l = 0; l < 10; l ++) osap.loop();
+  CHECK(bus.queuedFor(BUSY_DROP) == 0 && bus.queuedFor(QUIET_DROP) == 0);
+  boolean allFree = true;
+  for(uint8_t s = 0; s < VT_STACKSIZE; s ++){
+    if(bus.dropQueued[s] != 0 || bus.slotDrop[s] != VBUS_NO_DROP) allFree = false;
+  }
+  CHECK(allFree);
+  return TEST_RESULT();
+}
@@ -0,0 +1,167 @@
+/*
+osap/test/test_vport_posix_dgram.cpp
+
+datagram ports over localhost: frames round-trip whole & in order, and datagrams that are dropped
+out of a recvmmsg() batch (oversize, empty) don't leave holes in the stack
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_posix_dgram.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+OSAP osap("dgram_test");
+
+// a frame's bytes, from its sequence #
+static uint16_t fill(uint32_t seq, uint8_t* buf){
+  uint16_t len = 1 + (seq * 37) % VT_SLOTSIZE;
+  for(uint16_t i = 0; i < len; i ++) buf[i] = (uint8_t)(seq + i * 3);
+  return len;
+}
+
+static boolean matches(stackItem* item, uint32_t seq){
+  uint8_t buf[VT_SLOTSIZE];
+  uint16_t len = fill(seq, buf);
+  return item->len == len && memcmp(item->data, buf, len) == 0;
+}
+
+// 'till both ends are bound, datagrams are refused & dropped: ping 'till one gets thru, 
+static boolean warmUp(VPortPosixDgram* from, VPortPosixDgram* to){
+  uint8_t buf[4] = { 1, 2, 3, 4 };
+  stackItem* items[VT_STACKSIZE];
+  for(uint16_t i = 0; i < 1000; i ++){
+    from->send(buf, 4);
+    from->loop();
+    posixPoll(1);
+    to->loop();
+    uint8_t count = stackGetItems(to, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t c = 0; c < count; c ++) stackClearSlot(items[c]);
+    if(count > 0) return true;
+  }
+  return false;
+}
+
+int main(void){
+  char pathA[64], pathB[64];
+  snprintf(pathA, 64, "/tmp/osap_test_%d_a.sock", getpid());
+  snprintf(pathB, 64, "/tmp/osap_test_%d_b.sock", getpid());
+  stackItem* items[VT_STACKSIZE];
+  uint8_t buf[VT_SLOTSIZE + 64];
+
+  // ---- a sends to b, b echoes each back, both check what lands
+  VPortPosixDgram b(&osap, "b", pathB, pathA);
+  uint32_t txSeq = 0, rxSeq = 0, echoSeq = 0;
+  boolean inOrder = true;
+  {
+    VPortPosixDgram a(&osap, "a", pathA, pathB);
+    CHECK(a.isOpen() && b.isOpen());
+    CHECK(warmUp(&a, &b) && warmUp(&b, &a));
+    a.txRefused = b.txRefused = 0;
+    for(uint32_t pass = 0; pass < 100000 && echoSeq < 500; pass ++){
+      // a couple of frames in flight, so nothing's refused for a full socket,
+      while(txSeq < 500 && txSeq - echoSeq < VT_STACKSIZE - 1 && a.cts()){
+        uint16_t len = fill(txSeq, buf);
+        a.send(buf, len);
+        txSeq ++;
+      }
+      a.loop();
+      posixPoll(0);
+      b.loop();
+      uint8_t count = stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+      for(uint8_t i = 0; i < count && b.cts(); i ++){
+        if(!matches(items[i], rxSeq)) inOrder = false;
+        rxSeq ++;
+        b.send(items[i]->data, items[i]->len);
+        stackClearSlot(items[i]);
+      }
+      b.loop();
+      posixPoll(0);
+      a.loop();
+      count = stackGetItems(&a, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+      for(uint8_t i = 0; i < count; i ++){
+        if(!matches(items[i], echoSeq)) inOrder = false;
+        echoSeq ++;
+        stackClearSlot(items[i]);
+      }
+    }
+    CHECK(echoSeq == 500 && rxSeq == 500);
+    CHECK(inOrder);
+    CHECK(a.txRefused == 0 && b.txRefused == 0);
+    CHECK(a.rxTruncated == 0 && b.rxTruncated == 0);
+  }
+
+  // ---- a raw socket takes a's place: b's 1st send to it is refused (it's still connected to the old a), 
+  // & b reconnects, so the next gets there 
+  int raw = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_un local, remote;
+  memset(&local, 0, sizeof(local));
+  memset(&remote, 0, sizeof(remote));
+  local.sun_family = remote.sun_family = AF_UNIX;
+  strcpy(local.sun_path, pathA);
+  strcpy(remote.sun_path, pathB);
+  unlink(pathA);
+  CHECK(raw >= 0);
+  CHECK(bind(raw, (struct sockaddr*)&local, sizeof(local)) == 0);
+  uint16_t len = fill(999, buf);
+  b.send(buf, len);
+  b.loop();
+  CHECK(b.txRefused == 1);
+  len = fill(1000, buf);
+  b.send(buf, len);
+  b.loop();
+  uint8_t back[VT_SLOTSIZE];
+  ssize_t n = -1;
+  for(uint8_t i = 0; i < 100 && n < 0; i ++){
+    n = recv(raw, back, VT_SLOTSIZE, 0);
+    if(n < 0) usleep(1000);
+  }
+  CHECK(n == len && memcmp(back, buf, len) == 0);
+  CHECK(connect(raw, (struct sockaddr*)&remote, sizeof(remote)) == 0);
+
+  // ---- it sends b good frames w/ an oversize & an empty one mixed in: good, oversize, good, empty, good... 
+  // the 1st batch is [good, oversize, good], so the 2nd good is pulled back into the oversize one's slot, 
+  len = fill(1001, buf);
+  CHECK(send(raw, buf, len, 0) == len);
+  memset(buf, 0xee, VT_SLOTSIZE + 64);
+  CHECK(send(raw, buf, VT_SLOTSIZE + 64, 0) == VT_SLOTSIZE + 64);
+  len = fill(1002, buf);
+  CHECK(send(raw, buf, len, 0) == len);
+  CHECK(send(raw, buf, 0, 0) == 0);
+  len = fill(1003, buf);
+  CHECK(send(raw, buf, len, 0) == len);
+  uint32_t before = b.rxDatagrams;
+  for(uint8_t i = 0; i < 8; i ++){
+    posixPoll(2);
+    b.loop();
+  }
+  CHECK(b.rxTruncated == 2);
+  CHECK(b.rxDatagrams - before == 3);
+  CHECK(stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 3);
+  CHECK(matches(items[0], 1001));
+  CHECK(matches(items[1], 1002));
+  CHECK(matches(items[2], 1003));
+  // & the ring's still whole once they're handled, 
+  for(uint8_t i = 0; i < 3; i ++) stackClearSlot(items[i]);
+  len = fill(1004, buf);
+  CHECK(send(raw, buf, len, 0) == len);
+  for(uint8_t i = 0; i < 8; i ++){
+    posixPoll(2);
+    b.loop();
+  }
+  CHECK(stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1);
+  CHECK(matches(items[0], 1004));
+  close(raw);
+  unlink(pathA);
+  unlink(pathB);
+  return TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+/*
+osap/test/test_vport_posix_serial.cpp
+
+posix serial ports, across a pty pair: frames arrive whole & in order, incl. ones split across reads 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../utils/cobs.h"
+#include "../vertices/vport_posix_serial.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+OSAP osap("pty_test");
+
+// a frame's bytes, from its sequence # (w/ some zeroes, so cobs has work to do) 
+static uint16_t fill(uint32_t seq, uint8_t* buf){
+  uint16_t len = 1 + (seq * 37) % (VT_SLOTSIZE - 1);
+  for(uint16_t i = 0; i < len; i ++) buf[i] = (uint8_t)(seq + i * 3);
+  return len;
+}
+
+static boolean matches(stackItem* item, uint32_t seq){
+  uint8_t buf[VT_SLOTSIZE];
+  uint16_t len = fill(seq, buf);
+  return item->len == len && memcmp(item->data, buf, len) == 0;
+}
+
+// services both ends 'till nothing's moving, 
+static void settle(VPortPosixSerial* a, VPortPosixSerial* b){
+  for(uint8_t i = 0; i < 8; i ++){
+    a->loop();
+    b->loop();
+    posixPoll(2);
+  }
+}
+
+int main(void){
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  CHECK(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+  VPortPosixSerial a(&osap, "a", master);
+  VPortPosixSerial b(&osap, "b", ptsname(master));
+  CHECK(a.isOpen() && b.isOpen());
+  stackItem* items[VT_STACKSIZE];
+  uint8_t buf[VT_SLOTSIZE];
+
+  // ---- a few hundred frames, a to b, taken off the stack as they land 
+  uint32_t txSeq = 0, rxSeq = 0;
+  boolean inOrder = true;
+  for(uint32_t pass = 0; pass < 20000 && rxSeq < 300; pass ++){
+    while(txSeq < 300 && a.cts()){
+      uint16_t len = fill(txSeq, buf);
+      a.send(buf, len);
+      txSeq ++;
+    }
+    a.loop();
+    posixPoll(1);
+    b.loop();
+    uint8_t count = stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+    for(uint8_t i = 0; i < count; i ++){
+      if(!matches(items[i], rxSeq)) inOrder = false;
+      rxSeq ++;
+      stackClearSlot(items[i]);
+    }
+  }
+  CHECK(rxSeq == 300);
+  CHECK(inOrder);
+  CHECK(b.rxFramingErrors == 0);
+  CHECK(a.writevCalls < a.txFramesWritten);
+
+  // ---- a frame split across two reads, w/ a non-head frame handled in between 
+  uint8_t wire[VPORT_POSIX_FRAME_MAX * 3];
+  uint16_t wlen = 0;
+  for(uint32_t s = 1000; s < 1002; s ++){
+    uint16_t len = fill(s, buf);
+    wlen += cobsEncode(buf, len, &(wire[wlen]));
+    wire[wlen ++] = 0;
+  }
+  CHECK(::write(master, wire, wlen) == wlen);
+  settle(&a, &b);
+  CHECK(stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  uint16_t len = fill(1002, buf);
+  wlen = cobsEncode(buf, len, wire);
+  wire[wlen ++] = 0;
+  CHECK(::write(master, wire, 7) == 7);
+  settle(&a, &b);
+  CHECK(b.rxSlot != nullptr);
+  stackClearSlot(items[1]);
+  CHECK(::write(master, &(wire[7]), wlen - 7) == wlen - 7);
+  settle(&a, &b);
+  CHECK(stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  CHECK(matches(items[0], 1000));
+  CHECK(matches(items[1], 1002));
+  CHECK(b.rxFramingErrors == 0);
+  stackClearSlot(items[0]);
+  stackClearSlot(items[1]);
+
+  // ---- the far end hangs up: a closes, then comes back once it's reopened 
+  b.close();
+  uint32_t start = millis();
+  while(a.isOpen() && millis() - start < 1000){
+    a.loop();
+    posixPoll(2);
+  }
+  CHECK(!a.isOpen() && !a.cts());
+  VPortPosixSerial c(&osap, "c", ptsname(master));
+  start = millis();
+  while(!a.isOpen() && millis() - start < 1000){
+    a.loop();
+    c.loop();
+    posixPoll(2);
+  }
+  CHECK(a.isOpen());
+  // & carries frames again, 
+  len = fill(2000, buf);
+  CHECK(a.cts());
+  a.send(buf, len);
+  settle(&a, &c);
+  CHECK(stackGetItems(&c, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1);
+  CHECK(matches(items[0], 2000));
+  return TEST_RESULT();
+}
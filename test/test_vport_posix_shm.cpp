@@ -0,0 +1,110 @@
+/*
+osap/test/test_vport_posix_shm.cpp
+
+shm ports: a side whose process dies w/o closing is seen as gone & can be taken over, a live side
+can't be opened twice, and a region that's in use isn't reset out from under its peer
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_posix_shm.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <optional>
+
+OSAP osap("shm_test");
+
+// one frame from -> to, true if it lands intact
+static boolean pass(VPortPosixShm* from, VPortPosixShm* to, uint8_t tag){
+  uint8_t buf[8] = { tag, tag, tag, tag, tag, tag, tag, tag };
+  if(!from->cts()) return false;
+  from->send(buf, 8);
+  to->loop();
+  stackItem* items[VT_STACKSIZE];
+  if(stackGetItems(to, VT_STACK_ORIGIN, items, VT_STACKSIZE) != 1) return false;
+  boolean ok = (items[0]->len == 8 && items[0]->data[0] == tag);
+  stackClearSlot(items[0]);
+  return ok;
+}
+
+int main(void){
+  char path[64];
+  snprintf(path, 64, "/tmp/osap_test_%d.shm", getpid());
+  std::optional<VPortPosixShm> a;
+  a.emplace(&osap, "a", path, 0);
+  CHECK(a->region != nullptr && !a->isOpen());
+
+  // ---- a side 1 that dies w/o closing,
+  int sync[2];
+  CHECK(pipe(sync) == 0);
+  pid_t pid = fork();
+  if(pid == 0){
+    VPortPosixShm* b = new VPortPosixShm(&osap, "b", path, 1);
+    uint8_t ok = (b->region != nullptr);
+    if(write(sync[1], &ok, 1) != 1) _exit(1);
+    // wait for the word, then go w/o a word,
+    if(read(sync[0], &ok, 1) != 1) _exit(1);
+    _exit(0);
+  }
+  uint8_t ok = 0;
+  CHECK(read(sync[0], &ok, 1) == 1 && ok == 1);
+  CHECK(a->isOpen());
+  CHECK(write(sync[1], &ok, 1) == 1);
+  CHECK(waitpid(pid, nullptr, 0) == pid);
+  // is seen as gone, once we look again,
+  CHECK(a->region->attached[1].load() == (uint32_t)pid);
+  usleep((VPORT_SHM_LIVENESS_MS + 50) * 1000);
+  CHECK(!a->isOpen() && !a->cts());
+  // & its side can be taken over,
+  std::optional<VPortPosixShm> b;
+  b.emplace(&osap, "b", path, 1);
+  CHECK(b->region != nullptr);
+  CHECK(a->isOpen() && b->isOpen());
+  CHECK(pass(&(*a), &(*b), 1));
+  CHECK(pass(&(*b), &(*a), 2));
+
+  // ---- live sides can't be opened twice, & trying doesn't touch the rings,
+  uint8_t buf[8] = { 3, 3, 3, 3, 3, 3, 3, 3 };
+  a->send(buf, 8);
+  VPortPosixShm dup0(&osap, "dup0", path, 0);
+  VPortPosixShm dup1(&osap, "dup1", path, 1);
+  CHECK(dup0.region == nullptr && dup1.region == nullptr);
+  CHECK(a->isOpen() && b->isOpen());
+  b->loop();
+  stackItem* items[VT_STACKSIZE];
+  CHECK(stackGetItems(&(*b), VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1);
+  if(stackGetItems(&(*b), VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1){
+    CHECK(items[0]->data[0] == 3);
+    stackClearSlot(items[0]);
+  }
+
+  // ---- a new side 0 picks up the rings a live side 1 is using,
+  uint32_t head = a->region->rings[0].head.value.load();
+  CHECK(head == 2);
+  a.reset();
+  CHECK(!b->isOpen());
+  a.emplace(&osap, "a", path, 0);
+  CHECK(a->region != nullptr);
+  CHECK(a->region->rings[0].head.value.load() == head);
+  CHECK(a->isOpen() && b->isOpen());
+  CHECK(pass(&(*a), &(*b), 4));
+  CHECK(pass(&(*b), &(*a), 5));
+
+  // ---- & w/ no one left, the next side 0 starts them fresh
+  a.reset();
+  b.reset();
+  a.emplace(&osap, "a", path, 0);
+  CHECK(a->region != nullptr);
+  CHECK(a->region->rings[0].head.value.load() == 0 && a->region->rings[1].head.value.load() == 0);
+  a.reset();
+  unlink(path);
+  return TEST_RESULT();
+}
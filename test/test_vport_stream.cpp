@@ -0,0 +1,81 @@
+/*
+osap/test/test_vport_stream.cpp
+
+streamed rx decodes in place, & survives slots being cleared out from under a partial frame 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../utils/cobs.h"
+#include "../vertices/sim_links.h"
+
+SimClock simClock;
+OSAP osap("stream_test");
+VPortSim port(&osap, "port", &simClock, SimLinkParams());
+
+// a frame of len bytes, all 'fill', cobs'd & delimited 
+static uint16_t frame(uint8_t fill, uint16_t len, uint8_t* out){
+  uint8_t raw[VT_SLOTSIZE];
+  memset(raw, fill, len);
+  uint16_t encLen = cobsEncode(raw, len, out);
+  out[encLen ++] = 0;
+  return encLen;
+}
+
+static boolean holds(stackItem* item, uint8_t fill, uint16_t len){
+  if(item->len != len) return false;
+  for(uint16_t i = 0; i < len; i ++){
+    if(item->data[i] != fill) return false;
+  }
+  return true;
+}
+
+int main(void){
+  uint8_t wire[VT_SLOTSIZE + 8];
+  stackItem* items[VT_STACKSIZE];
+  // two frames land, 
+  uint16_t len = frame(0x11, 20, wire);
+  CHECK(port.injestStream(wire, len) == len);
+  len = frame(0x22, 30, wire);
+  CHECK(port.injestStream(wire, len) == len);
+  CHECK(stackGetItems(&port, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  // the third arrives in two chunks, & the 2nd (not the head) is handled in between, 
+  len = frame(0x33, 40, wire);
+  CHECK(port.injestStream(wire, 10) == 10);
+  stackClearSlot(items[1]);
+  CHECK(port.injestStream(&(wire[10]), len - 10) == len - 10);
+  CHECK(port.rxFramingErrors == 0);
+  CHECK(port.rxSlot == nullptr);
+  // & it lands, behind the 1st, 
+  CHECK(stackGetItems(&port, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 2);
+  CHECK(holds(items[0], 0x11, 20));
+  CHECK(holds(items[1], 0x33, 40));
+  // the same, when the queue empties entirely under a partial frame, 
+  len = frame(0x44, 50, wire);
+  CHECK(port.injestStream(wire, 5) == 5);
+  stackClearSlot(items[1]);
+  stackClearSlot(items[0]);
+  CHECK(port.injestStream(&(wire[5]), len - 5) == len - 5);
+  CHECK(stackGetItems(&port, VT_STACK_ORIGIN, items, VT_STACKSIZE) == 1);
+  CHECK(holds(items[0], 0x44, 50));
+  // & the ring is still whole: it fills to the usual depth, in order 
+  stackClearSlot(items[0]);
+  uint8_t loaded = 0;
+  while(stackEmptySlot(&port, VT_STACK_ORIGIN)){
+    len = frame(0x50 + loaded, 8, wire);
+    CHECK(port.injestStream(wire, len) == len);
+    loaded ++;
+  }
+  CHECK(loaded == VT_STACKSIZE - 1);
+  CHECK(stackGetItems(&port, VT_STACK_ORIGIN, items, VT_STACKSIZE) == loaded);
+  for(uint8_t i = 0; i < loaded; i ++) CHECK(holds(items[i], 0x50 + i, 8));
+  return TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+/*
+osap/test/test_vport_thread_link.cpp
+
+thread links: frames cross between threads in order, & either end can go away 1st 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "test.h"
+#include "../core/osap.h"
+#include "../vertices/vport_thread_link.h"
+#include <thread>
+#include <optional>
+
+#define FRAMES 100000 
+
+OSAP rootA("thread_a");
+OSAP rootB("thread_b");
+
+static boolean pass(VPortThreadLink* from, VPortThreadLink* to, uint8_t tag){
+  uint8_t buf[8] = { tag, 1, 2, 3, 4, 5, 6, 7 };
+  if(!from->cts()) return false;
+  from->send(buf, 8);
+  to->loop();
+  stackItem* items[VT_STACKSIZE];
+  if(stackGetItems(to, VT_STACK_ORIGIN, items, VT_STACKSIZE) != 1) return false;
+  boolean ok = (items[0]->len == 8 && items[0]->data[0] == tag);
+  stackClearSlot(items[0]);
+  return ok;
+}
+
+// one end is torn down, the other sees it close & carries on safely, 
+// then goes too, & the last one out frees the link 
+static void teardown(boolean aFirst){
+  std::optional<VPortThreadLink> a, b;
+  a.emplace(&rootA, "a");
+  b.emplace(&rootB, "b");
+  VPortThreadLink::connect(&(*a), &(*b));
+  CHECK(a->isOpen() && b->isOpen());
+  CHECK(pass(&(*a), &(*b), 1));
+  CHECK(pass(&(*b), &(*a), 2));
+  std::optional<VPortThreadLink>& gone = (aFirst ? a : b);
+  std::optional<VPortThreadLink>& left = (aFirst ? b : a);
+  gone.reset();
+  CHECK(!left->isOpen() && !left->cts());
+  uint8_t buf[4] = { 1, 2, 3, 4 };
+  left->send(buf, 4);
+  left->loop();
+  left.reset();
+}
+
+// ports can be dropped & re-linked, 
+static void relink(void){
+  VPortThreadLink a(&rootA, "a");
+  VPortThreadLink b(&rootB, "b");
+  VPortThreadLink::connect(&a, &b);
+  a.disconnect();
+  CHECK(!a.isOpen() && !b.isOpen());
+  b.disconnect();
+  CHECK(b.link == nullptr);
+  VPortThreadLink::connect(&a, &b);
+  CHECK(pass(&a, &b, 3));
+  CHECK(pass(&b, &a, 4));
+}
+
+int main(void){
+  teardown(true);
+  teardown(false);
+  relink();
+  // two threads, each servicing its own end, 
+  VPortThreadLink a(&rootA, "a");
+  VPortThreadLink b(&rootB, "b");
+  VPortThreadLink::connect(&a, &b);
+  uint32_t errors = 0;
+  std::thread rx([&](){
+    stackItem* items[VT_STACKSIZE];
+    uint32_t seq = 0;
+    while(seq < FRAMES){
+      b.loop();
+      uint8_t count = stackGetItems(&b, VT_STACK_ORIGIN, items, VT_STACKSIZE);
+      for(uint8_t i = 0; i < count; i ++){
+        uint16_t rptr = 0;
+        if(items[i]->len != 4 || ts_readUint32(items[i]->data, &rptr) != seq) errors ++;
+        seq ++;
+        stackClearSlot(items[i]);
+      }
+      if(count == 0) std::this_thread::yield();
+    }
+  });
+  for(uint32_t seq = 0; seq < FRAMES; seq ++){
+    uint8_t buf[4];
+    uint16_t wptr = 0;
+    ts_writeUint32(seq, buf, &wptr);
+    while(!a.cts()) std::this_thread::yield();
+    a.send(buf, 4);
+  }
+  rx.join();
+  CHECK(errors == 0);
+  CHECK(a.txFrames == FRAMES && b.rxFrames == FRAMES);
+  return TEST_RESULT();
+}
@@ -11,6 +11,9 @@ no warranty is provided, and users accept all liability.
 */
 
 #include "cobs.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif 
 // str8 crib from
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
 
@@ -68,3 +71,189 @@ size_t cobsDecode(const uint8_t *buffer, size_t length, void *data){
 
 	return decode - (uint8_t *)data;
 }
+
+// # of non-zero bytes at the start of data, up to length 
+static inline size_t cobsZeroScan(const uint8_t *data, size_t length){
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= length; i += 16){
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), zero));
+		if (mask) return i + __builtin_ctz(mask);
+	}
+#endif
+	// swar: a word has a zero byte iff (v - 0x01..) & ~v & 0x80.. is non-zero, 
+	// memcpy loads are single (unaligned-ok) loads on hosts and cortex-m3+ 
+	const size_t ones = ~(size_t)0 / 0xff;
+	const size_t highs = ones << 7;
+	for (; i + sizeof(size_t) <= length; i += sizeof(size_t)){
+		size_t v;
+		memcpy(&v, data + i, sizeof(size_t));
+		if ((v - ones) & ~v & highs) break;
+	}
+	// the word w/ the zero (or the tail), bytewise 
+	while (i < length && data[i]) i ++;
+	return i;
+}
+
+// runs are mostly short, so they're copied w/ word moves, the last one overlapping, which never writes past 
+// dst + n... a plain memcpy() w/ a small, bounded n gets inlined as rep movs, w/ a startup cost of ~ 40 cycles 
+static inline void cobsCopyRun(uint8_t *dst, const uint8_t *src, size_t n){
+	if (n >= 8){
+		uint64_t w;
+		for (size_t i = 0; i + 8 < n; i += 8){
+			memcpy(&w, src + i, 8);
+			memcpy(dst + i, &w, 8);
+		}
+		memcpy(&w, src + n - 8, 8);
+		memcpy(dst + n - 8, &w, 8);
+	} else if (n >= 4){
+		uint32_t a, b;
+		memcpy(&a, src, 4);
+		memcpy(&b, src + n - 4, 4);
+		memcpy(dst, &a, 4);
+		memcpy(dst + n - 4, &b, 4);
+	} else {
+		for (size_t i = 0; i < n; i ++) dst[i] = src[i];
+	}
+}
+
+/** COBS encode data to buffer, a run at a time 
+	@note same output as cobsEncode(), incl. the code byte it leaves past the end after a full final block 
+*/
+size_t cobsEncodeFast(const void *data, size_t length, uint8_t *buffer){
+	if (length < COBS_FAST_MIN_LENGTH) return cobsEncode(data, length, buffer);
+
+	const uint8_t *in = (const uint8_t *)data;
+	uint8_t *encode = buffer;
+	uint8_t *codep = encode++;
+
+	for (;;){
+		size_t run = cobsZeroScan(in, length < 0xfe ? length : 0xfe);
+		cobsCopyRun(encode, in, run);
+		encode += run, in += run, length -= run;
+		if (run == 0xfe){ // block completed, restart 
+			*codep = 0xff, codep = encode;
+			if (!length){
+				*codep = 1;
+				return encode - buffer;
+			}
+			++encode;
+		} else if (!length){ // ran out of input 
+			*codep = run + 1;
+			return encode - buffer;
+		} else { // hit a zero, 
+			*codep = run + 1, codep = encode++;
+			++in, --length;
+			if (!length){
+				*codep = 1;
+				return encode - buffer;
+			}
+		}
+	}
+}
+
+/** COBS decode data from buffer, a block at a time 
+	@note same output as cobsDecode(), incl. the zero it writes before stopping at a delimiter 
+*/
+size_t cobsDecodeFast(const uint8_t *buffer, size_t length, void *data){
+	if (length < COBS_FAST_MIN_LENGTH) return cobsDecode(buffer, length, data);
+
+	const uint8_t *byte = buffer;
+	const uint8_t *end = buffer + length;
+	uint8_t *decode = (uint8_t *)data;
+
+	for (uint8_t code = 0xff; byte < end;){
+		if (code != 0xff) // Encoded zero, write it
+			*decode++ = 0;
+		code = *byte++;
+		if (code == 0x00) // Delimiter code found
+			break;
+		size_t block = code - 1;
+		if (block > (size_t)(end - byte)) block = end - byte;
+		cobsCopyRun(decode, byte, block);
+		decode += block, byte += block;
+	}
+
+	return decode - (uint8_t *)data;
+}
+
+void cobsStreamBegin(COBSStreamDecoder *dec, uint8_t *out, size_t maxLength){
+	dec->out = out;
+	dec->maxLength = maxLength;
+	dec->len = 0;
+	dec->code = 0xff;
+	dec->block = 0;
+	dec->skipping = false;
+}
+
+// back to the start of a frame, same buffer 
+static inline void cobsStreamRestart(COBSStreamDecoder *dec){
+	dec->len = 0;
+	dec->code = 0xff;
+	dec->block = 0;
+}
+
+uint8_t cobsStreamFeed(COBSStreamDecoder *dec, const uint8_t *bytes, size_t length, size_t *consumed){
+	const uint8_t *byte = bytes;
+	const uint8_t *end = bytes + length;
+	uint8_t result = COBS_STREAM_MORE;
+
+	while (byte < end){
+		// dropping a bad frame: skip to the delimiter, 
+		if (dec->skipping){
+			const uint8_t *delim = (const uint8_t *)memchr(byte, 0, end - byte);
+			if (delim == nullptr){
+				byte = end;
+				break;
+			}
+			byte = delim + 1;
+			dec->skipping = false;
+			cobsStreamRestart(dec);
+			continue;
+		}
+		// inside a block: copy literals up to the block's end, or the chunk's, or a zero 
+		if (dec->block){
+			size_t span = end - byte;
+			if (span > dec->block) span = dec->block;
+			const uint8_t *delim = (const uint8_t *)memchr(byte, 0, span);
+			if (delim != nullptr) span = delim - byte;
+			if (dec->len + span > dec->maxLength){
+				dec->skipping = true;
+				result = COBS_STREAM_ERROR;
+				break;
+			}
+			memcpy(dec->out + dec->len, byte, span);
+			dec->len += span, dec->block -= span, byte += span;
+			// a delimiter mid-block is a truncated frame, 
+			if (delim != nullptr){
+				++byte;
+				cobsStreamRestart(dec);
+				result = COBS_STREAM_ERROR;
+				break;
+			}
+			continue;
+		}
+		// at a code byte (or the delimiter), 
+		uint8_t code = *byte++;
+		if (code == 0x00){
+			// back-to-back delimiters are just idle line, 
+			if (dec->len == 0 && dec->code == 0xff) continue;
+			result = COBS_STREAM_FRAME;
+			break;
+		}
+		if (dec->code != 0xff){ // Encoded zero, write it
+			if (dec->len >= dec->maxLength){
+				dec->skipping = true;
+				result = COBS_STREAM_ERROR;
+				break;
+			}
+			dec->out[dec->len++] = 0;
+		}
+		dec->code = code;
+		dec->block = code - 1;
+	}
+
+	*consumed = byte - bytes;
+	return result;
+}
@@ -21,4 +21,36 @@ size_t cobsEncode(const void *data, size_t length, uint8_t *buffer);
 
 size_t cobsDecode(const uint8_t *buffer, size_t length, void *data);
 
+// block-at-a-time versions of the above, w/ byte-identical output: 
+// encode scans for zeroes a word (or sse2 vector) at a time and copies runs whole, 
+// decode copies each block whole... below this many bytes they just call the originals 
+#ifndef COBS_FAST_MIN_LENGTH
+#define COBS_FAST_MIN_LENGTH 32 
+#endif 
+
+size_t cobsEncodeFast(const void *data, size_t length, uint8_t *buffer);
+
+size_t cobsDecodeFast(const uint8_t *buffer, size_t length, void *data);
+
+// resumable decoder, for feeding bytes (or chunks) as they arrive, decoding straight into 
+// the caller's buffer... frames are ended by the 0x00 delimiter, 
+#define COBS_STREAM_MORE 0      // consumed all given bytes, no frame yet 
+#define COBS_STREAM_FRAME 1     // a frame finished, decoder->len is its length 
+#define COBS_STREAM_ERROR 2     // a frame was dropped, for overflow or a short block 
+
+typedef struct COBSStreamDecoder {
+  uint8_t *out = nullptr;       // where we're decoding to, 
+  size_t maxLength = 0;
+  size_t len = 0;               // decoded so far, 
+  uint8_t code = 0xff;          // last code byte, 
+  uint8_t block = 0;            // literal bytes left in this block, 
+  bool skipping = false;        // after an error, we drop bytes up to the next delimiter 
+} COBSStreamDecoder;
+
+// (re)point the decoder at a buffer, dropping any partial frame 
+void cobsStreamBegin(COBSStreamDecoder *dec, uint8_t *out, size_t maxLength);
+// feeds bytes until a frame ends, an error occurs, or bytes run out: *consumed is set to the # eaten, 
+// after an ERROR it carries on w/ the next frame in the same buffer, after a FRAME read ->len and then Begin() again 
+uint8_t cobsStreamFeed(COBSStreamDecoder *dec, const uint8_t *bytes, size_t length, size_t *consumed);
+
 #endif
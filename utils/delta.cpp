@@ -0,0 +1,85 @@
+/*
+utils/delta.cpp
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "delta.h"
+
+// frames are xor'd against a reference (zero-padded past refLen), and that is written as 
+// uint16 frame length, then runs of <zeroCount, literalCount, literals...> til the end, 
+// so bytes that didn't change cost ~ nothing, and bytes that did cost themselves + a little 
+
+/** delta-encode data against ref
+	@param ref Pointer to the reference (last acked) frame
+	@param refLen Reference length in bytes
+	@param data Pointer to the new frame
+	@param length New frame length in bytes
+	@param buffer Pointer to encoded output buffer
+	@param maxLength Max bytes to write into buffer
+	@return Encoded length in bytes, or 0 if it doesn't fit in maxLength 
+*/
+size_t deltaEncode(const uint8_t *ref, size_t refLen, const uint8_t *data, size_t length, uint8_t *buffer, size_t maxLength){
+	if(maxLength < 2 || length > 0xffff) return 0;
+	size_t wptr = 0;
+	buffer[wptr ++] = length & 255;
+	buffer[wptr ++] = (length >> 8) & 255;
+	size_t i = 0;
+	while(i < length){
+		// count unchanged bytes, 
+		uint8_t zeroes = 0;
+		while(i < length && zeroes < 0xff && (data[i] ^ (i < refLen ? ref[i] : 0)) == 0){
+			zeroes ++; i ++;
+		}
+		// then changed ones, 
+		size_t litStart = i;
+		uint8_t literals = 0;
+		while(i < length && literals < 0xff && (data[i] ^ (i < refLen ? ref[i] : 0)) != 0){
+			literals ++; i ++;
+		}
+		if(wptr + 2 + literals > maxLength) return 0;
+		buffer[wptr ++] = zeroes;
+		buffer[wptr ++] = literals;
+		for(size_t l = litStart; l < litStart + literals; l ++){
+			buffer[wptr ++] = data[l] ^ (l < refLen ? ref[l] : 0);
+		}
+	}
+	return wptr;
+}
+
+/** rebuild a frame from ref and a delta 
+	@param ref Pointer to the reference frame the delta was written against
+	@param refLen Reference length in bytes
+	@param buffer Pointer to encoded delta 
+	@param length Encoded length in bytes
+	@param data Pointer to decoded output frame, may not alias ref 
+	@param maxLength Max bytes to write into data
+	@return Decoded frame length, or 0 if the delta is malformed or doesn't fit 
+*/
+size_t deltaDecode(const uint8_t *ref, size_t refLen, const uint8_t *buffer, size_t length, uint8_t *data, size_t maxLength){
+	if(length < 2) return 0;
+	size_t frameLen = buffer[0] | (buffer[1] << 8);
+	if(frameLen > maxLength) return 0;
+	size_t rptr = 2;
+	size_t i = 0;
+	while(rptr + 2 <= length){
+		uint8_t zeroes = buffer[rptr ++];
+		uint8_t literals = buffer[rptr ++];
+		if(i + zeroes + literals > frameLen || rptr + literals > length) return 0;
+		for(uint8_t z = 0; z < zeroes; z ++, i ++){
+			data[i] = (i < refLen ? ref[i] : 0);
+		}
+		for(uint8_t l = 0; l < literals; l ++, i ++){
+			data[i] = buffer[rptr ++] ^ (i < refLen ? ref[i] : 0);
+		}
+	}
+	// a well formed delta covers the whole frame, 
+	if(i != frameLen || rptr != length) return 0;
+	return frameLen;
+}
@@ -0,0 +1,24 @@
+/*
+utils/delta.h
+
+xor / zero-run delta coding of successive payloads 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef UTIL_DELTA_H_
+#define UTIL_DELTA_H_
+
+#include <Arduino.h>
+
+size_t deltaEncode(const uint8_t *ref, size_t refLen, const uint8_t *data, size_t length, uint8_t *buffer, size_t maxLength);
+
+size_t deltaDecode(const uint8_t *ref, size_t refLen, const uint8_t *buffer, size_t length, uint8_t *data, size_t maxLength);
+
+#endif
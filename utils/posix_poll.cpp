@@ -0,0 +1,54 @@
+/*
+utils/posix_poll.cpp
+
+one epoll set for all of a host process' fd-backed vports 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "posix_poll.h"
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define POSIX_POLL_MAX_EVENTS 32 
+
+// one set per thread, so each thread's root polls only its own ports 
+static thread_local int epfd = -1;
+
+boolean posixPollAdd(PosixPollable* pb){
+  if(epfd < 0) epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(epfd < 0 || pb->fd < 0) return false;
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = pb;
+  return (epoll_ctl(epfd, EPOLL_CTL_ADD, pb->fd, &ev) == 0);
+}
+
+void posixPollRemove(PosixPollable* pb){
+  if(epfd < 0 || pb->fd < 0) return;
+  epoll_ctl(epfd, EPOLL_CTL_DEL, pb->fd, nullptr);
+}
+
+int posixPoll(int timeoutMs){
+  if(epfd < 0) return 0;
+  struct epoll_event events[POSIX_POLL_MAX_EVENTS];
+  int n = epoll_wait(epfd, events, POSIX_POLL_MAX_EVENTS, timeoutMs);
+  for(int e = 0; e < n; e ++){
+    PosixPollable* pb = (PosixPollable*)events[e].data.ptr;
+    if(events[e].events & EPOLLIN) pb->readable = true;
+    if(events[e].events & EPOLLOUT) pb->writable = true;
+    if(events[e].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) pb->hangup = true;
+  }
+  return (n < 0 ? 0 : n);
+}
+
+#endif 
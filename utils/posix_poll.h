@@ -0,0 +1,38 @@
+/*
+utils/posix_poll.h
+
+one epoll set for all of a host process' fd-backed vports 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef UTIL_POSIX_POLL_H_
+#define UTIL_POSIX_POLL_H_
+
+#if defined(__linux__)
+
+#include <Arduino.h>
+
+// fd's are registered (per thread) edge-triggered, and posixPoll() just latches readiness here, 
+// ports' loop()s then do their i/o until EAGAIN and clear the flags... so a host runs i.e. 
+// while(true){ osap.loop(); posixPoll(busy ? 0 : 1); } and pays one syscall per pass for all of its ports 
+typedef struct PosixPollable {
+  int fd = -1;
+  boolean readable = true;    // true til we've drained once, 
+  boolean writable = true;
+  boolean hangup = false;
+} PosixPollable;
+
+boolean posixPollAdd(PosixPollable* pb);
+void posixPollRemove(PosixPollable* pb);
+// waits up to timeoutMs (0: don't, -1: forever) for any fd to be ready, returns # of ready fds 
+int posixPoll(int timeoutMs);
+
+#endif 
+#endif 
@@ -15,21 +15,95 @@ no warranty is provided, and users accept all liability.
 #include "endpoint.h"
 #include "../core/osap.h"
 #include "../core/packets.h"
+#include "../utils/delta.h"
 
 // -------------------------------------------------------- Constructors 
 
 // route constructor 
 EndpointRoute::EndpointRoute(Route* _route, uint8_t _mode, uint32_t _timeoutLength){
-  if(_mode != EP_ROUTEMODE_ACKED && _mode != EP_ROUTEMODE_ACKLESS){
+  if(_mode != EP_ROUTEMODE_ACKED && _mode != EP_ROUTEMODE_ACKLESS && _mode != EP_ROUTEMODE_ACKED_DELTA && _mode != EP_ROUTEMODE_ACKED_WIDE){
     _mode = EP_ROUTEMODE_ACKLESS;
   }
   route = _route;
   ackMode = _mode;
   timeoutLength = _timeoutLength;
+  // til we've measured something, the given timeout is our best guess, 
+  // (ms -> us in 64 bits, so long timeouts clamp rather than wrap) 
+  rto = (uint32_t)constrain((uint64_t)_timeoutLength * 1000, (uint64_t)EP_RTO_MIN_US, (uint64_t)EP_RTO_MAX_US);
+  // delta routes hold two frames, so we only pay for 'em here, 
+  if(ackMode == EP_ROUTEMODE_ACKED_DELTA){
+    deltaRef = new uint8_t[VT_SLOTSIZE];
+    deltaPending = new uint8_t[VT_SLOTSIZE];
+  }
 }
 
 EndpointRoute::~EndpointRoute(void){
   delete route;
+  if(deltaRef != nullptr) delete[] deltaRef;
+  if(deltaPending != nullptr) delete[] deltaPending;
+}
+
+boolean EndpointRoute::useWideIds(void){
+  return (ackMode == EP_ROUTEMODE_ACKED_WIDE && !wideFallback);
+}
+
+void EndpointRoute::ackTimedOut(void){
+  timeoutCount ++;
+  // likely loss or congestion: back off 'til an ack gives us a fresh sample, 
+  rto = min(rto * 2, (uint32_t)EP_RTO_MAX_US);
+  // if they've never acked a wide id, they likely don't speak 'em, 
+  if(txWide && !wideConfirmed) wideFallback = true;
+}
+
+void EndpointRoute::rttSample(uint32_t rtt){
+  ackCount ++;
+  if(srtt == 0){
+    srtt = rtt;
+    rttvar = rtt / 2;
+  } else {
+    uint32_t err = (srtt > rtt ? srtt - rtt : rtt - srtt);
+    rttvar = rttvar - (rttvar >> 2) + (err >> 2);
+    srtt = srtt - (srtt >> 3) + (rtt >> 3);
+  }
+  rto = constrain(srtt + 4 * rttvar, EP_RTO_MIN_US, EP_RTO_MAX_US);
+}
+
+boolean EndpointRoute::ackIsLate(uint32_t nowMicros){
+  return (nowMicros - lastTxMicros > rto);
+}
+
+void EndpointRoute::setRate(uint32_t _rateDatagrams, uint32_t _rateBytes, uint16_t _burstDatagrams, uint32_t _burstBytes){
+  rateDatagrams = _rateDatagrams;
+  rateBytes = _rateBytes;
+  paced = (rateDatagrams != 0 || rateBytes != 0);
+  if(_burstDatagrams < 1) _burstDatagrams = 1;
+  if(_burstBytes == 0) _burstBytes = (uint32_t)_burstDatagrams * VT_SLOTSIZE;
+  // tolerances are the bucket depths, in us: tats may run this far ahead of 'now', less what the next tx costs 
+  dgTolerance = (rateDatagrams ? ((uint64_t)_burstDatagrams * 1000000) / rateDatagrams : 0);
+  byteTolerance = (rateBytes ? ((uint64_t)_burstBytes * 1000000) / rateBytes : 0);
+  // start w/ full buckets, 
+  dgTat = byteTat = notBeforeMicros = micros();
+}
+
+// true if this route has to wait for tokens, 
+boolean EndpointRoute::tooSoon(uint32_t nowMicros){
+  return (paced && (int32_t)(nowMicros - notBeforeMicros) < 0);
+}
+
+void EndpointRoute::spendTokens(uint32_t nowMicros, uint16_t len){
+  if(!paced) return;
+  // empty buckets don't go negative: tats never lag 'now' 
+  if((int32_t)(dgTat - nowMicros) < 0) dgTat = nowMicros;
+  if((int32_t)(byteTat - nowMicros) < 0) byteTat = nowMicros;
+  uint32_t dgCost = (rateDatagrams ? 1000000 / rateDatagrams : 0);
+  uint32_t byteCost = (rateBytes ? ((uint64_t)len * 1000000) / rateBytes : 0);
+  dgTat += dgCost;
+  byteTat += byteCost;
+  // next tx can go when both buckets have room for it, gcra style: the tat less (depth - cost), 
+  // where the next tx is taken to cost what this one did (one datagram, & about as many bytes) 
+  uint32_t dgReady = dgTat - (dgTolerance > dgCost ? dgTolerance - dgCost : 0);
+  uint32_t byteReady = byteTat - (byteTolerance > byteCost ? byteTolerance - byteCost : 0);
+  notBeforeMicros = ((int32_t)(dgReady - byteReady) > 0 ? dgReady : byteReady);
 }
 
 // base constructor, 
@@ -43,11 +117,15 @@ Endpoint::Endpoint(
   // set callbacks,
   if(_onData) onData_cb = _onData;
   if(_beforeQuery) beforeQuery_cb = _beforeQuery;
+  for(uint16_t s = 0; s < EP_ACK_TABLE_SIZE; s ++){
+    ackTable[s] = nullptr;
+  }
 }
 
 // -------------------------------------------------------- Dummies / Defaults 
 
 EP_ONDATA_RESPONSES onDataDefault(uint8_t* data, uint16_t len){
+  (void)data; (void)len;
   return EP_ONDATA_ACCEPT;
 }
 
@@ -57,48 +135,203 @@ boolean beforeQueryDefault(void){
 
 // -------------------------------------------------------- Endpoint Route / Write API 
 
+EP_ONDATA_RESPONSES Endpoint::onData(uint8_t* _data, uint16_t len){
+  return onData_cb(_data, len);
+}
+
 void Endpoint::write(uint8_t* _data, uint16_t len){
-  // copy data in,
   if(len > VT_SLOTSIZE) return; // no lol 
-  memcpy(data, _data, len);
+  // new version: routes pick up freshness in loop() by comparing against this, 
+  // so superseded versions that never made it out are simply skipped 
+  version ++;
+  publish(_data, len);
+}
+
+// copy into the buffer that isn't being read, and flip latest to it, 
+void Endpoint::publish(uint8_t* _data, uint16_t len){
+  uint8_t next = latest ^ 1;
+  // if loop() still holds the other one, latest itself is free to overwrite 
+  if(next == reading) next = latest;
+  memcpy(store[next], _data, len);
+  storeLen[next] = len;
+  storeVersion[next] = version;
+  latest = next;
   dataLen = len;
-  // set route freshness 
-  for(uint8_t r = 0; r < numRoutes; r ++){
-    if(routes[r]->state == EP_TX_AWAITING_ACK){
-      routes[r]->state = EP_TX_AWAITING_AND_FRESH;
-    } else {
-      routes[r]->state = EP_TX_FRESH;
-    }
-  }
+  // whatever's in the store now, it isn't the last acked frame (rx paths that publish one re-set this after) 
+  rxRefValid = false;
+}
+
+// the frame just published came in acked on this item, so it's what the sender will delta against, 
+void Endpoint::setRxRef(stackItem* item, uint16_t ptr){
+  if(ptr - 4 > (uint16_t)sizeof(rxRefPath)) return;
+  rxRefId = item->data[ptr + 3];
+  rxRefPathLen = ptr - 4;
+  memcpy(rxRefPath, &(item->data[4]), rxRefPathLen);
+  rxRefValid = true;
+}
+
+// true if the store holds the frame this delta was built on: same id, from the same sender, 
+boolean Endpoint::isRxRef(stackItem* item, uint16_t ptr, uint8_t baseId){
+  if(!rxRefValid || baseId != rxRefId || ptr - 4 != rxRefPathLen) return false;
+  return (memcmp(rxRefPath, &(item->data[4]), rxRefPathLen) == 0);
+}
+
+// claim the latest buffer for reading, publish() won't write into it 'till the next snapshot, 
+uint8_t Endpoint::snapshot(void){
+  reading = latest;
+  return reading;
 }
 
 // add a route to an endpoint, returns indice where it's dropped, 
-uint8_t Endpoint::addRoute(Route* _route, uint8_t _mode, uint32_t _timeoutLength){
+uint8_t Endpoint::addRoute(Route* _route, uint8_t _mode, uint32_t _timeoutLength, uint32_t _rateDatagrams, uint32_t _rateBytes){
 	// guard against more-than-allowed routes 
 	if(numRoutes >= ENDPOINT_MAX_ROUTES) {
-    OSAP::error("route add is oob", MEDIUM); 
+    OSAP_ERROR(TRACE_EP_ROUTES_OOB, MEDIUM, this, numRoutes); 
     return 0;
 	}
   // build, stash, increment 
   uint8_t indice = numRoutes;
   routes[numRoutes ++] = new EndpointRoute(_route, _mode, _timeoutLength);
+  if(_rateDatagrams || _rateBytes) routes[indice]->setRate(_rateDatagrams, _rateBytes);
+  // new routes tx on the next write, not the current data, 
+  routes[indice]->txVersion = version;
+  bumpTopology();
   return indice; 
 }
 
 boolean Endpoint::clearToWrite(void){
   for(uint8_t r = 0; r < numRoutes; r ++){
-    if(routes[r]->state != EP_TX_IDLE){
+    if(routes[r]->state != EP_TX_IDLE || routes[r]->txVersion != version){
       return false;
     }
   }
   return true;
 }
 
+void Endpoint::setQueryFreshness(uint32_t ms){
+  queryFreshness = ms;
+  queryRefreshed = false;
+}
+
+// -------------------------------------------------------- Ack Table 
+
+// the next id in sequence that isn't outstanding, which is then filed under rt, 
+uint16_t Endpoint::takeAckId(EndpointRoute* rt, boolean wide){
+  // whatever it was waiting on is abandoned, 
+  if(rt->ackOutstanding){
+    ackTableRemove(rt);
+    rt->ackOutstanding = false;
+  }
+  // at most ENDPOINT_MAX_ROUTES - 1 others are live, so this doesn't go far, 
+  uint16_t id = 0;
+  for(uint16_t n = 0; n < 256; n ++){
+    nextAckId ++;
+    id = (wide ? nextAckId : (nextAckId & 255));
+    if(ackTableFind(id) == nullptr) break;
+  }
+  rt->ackId = id;
+  // linear probe to a free spot, there's always one, 
+  uint16_t i = id % EP_ACK_TABLE_SIZE;
+  while(ackTable[i] != nullptr) i = (i + 1) % EP_ACK_TABLE_SIZE;
+  ackTable[i] = rt;
+  rt->ackOutstanding = true;
+  return id;
+}
+
+EndpointRoute* Endpoint::ackTableFind(uint16_t id){
+  uint16_t i = id % EP_ACK_TABLE_SIZE;
+  for(uint16_t n = 0; n < EP_ACK_TABLE_SIZE; n ++){
+    if(ackTable[i] == nullptr) return nullptr;
+    if(ackTable[i]->ackId == id) return ackTable[i];
+    i = (i + 1) % EP_ACK_TABLE_SIZE;
+  }
+  return nullptr;
+}
+
+void Endpoint::ackTableRemove(EndpointRoute* rt){
+  uint16_t i = rt->ackId % EP_ACK_TABLE_SIZE;
+  uint16_t n = 0;
+  while(ackTable[i] != rt){
+    if(ackTable[i] == nullptr || ++ n >= EP_ACK_TABLE_SIZE) return;
+    i = (i + 1) % EP_ACK_TABLE_SIZE;
+  }
+  ackTable[i] = nullptr;
+  // then pull later entries of the same probe run back over the hole, so finds don't stop short, 
+  uint16_t j = i;
+  for(n = 0; n < EP_ACK_TABLE_SIZE; n ++){
+    j = (j + 1) % EP_ACK_TABLE_SIZE;
+    if(ackTable[j] == nullptr) break;
+    uint16_t home = ackTable[j]->ackId % EP_ACK_TABLE_SIZE;
+    // it can move if its home isn't cyclically within (i, j] 
+    boolean stays = (i <= j ? (home > i && home <= j) : (home > i || home <= j));
+    if(!stays){
+      ackTable[i] = ackTable[j];
+      ackTable[j] = nullptr;
+      i = j;
+    }
+  }
+}
+
+// -------------------------------------------------------- Borrowed Slot API 
+
+// hand back a slot that was retained in onBorrow_cb, clears it & acks if it was an acked tx, 
+void Endpoint::release(stackItem* handle){
+  if(handle == nullptr || handle->vt != this || !(handle->borrowed)){
+    OSAP_ERROR(TRACE_EP_RELEASE_BAD, MINOR, this);
+    return;
+  }
+  handle->borrowed = false;
+  uint16_t ptr = 0;
+  if(!findPtr(handle->data, &ptr)){
+    OSAP_ERROR(TRACE_EP_RELEASE_NO_PTR, MINOR, this);
+    stackClearSlot(handle);
+    return;
+  }
+  if(handle->data[ptr + 2] == EP_SS_ACKED || handle->data[ptr + 2] == EP_SS_ACKED_WIDE){
+    ackBorrowed(handle, ptr);
+  } else {
+    stackClearSlot(handle);
+  }
+}
+
+// a borrowed acked frame is done with: once it's acked, a delta sender will build on it, so a keyframe 
+// (narrow ids) is copied into the store first, to be the reference... the one copy borrow mode does make 
+void Endpoint::ackBorrowed(stackItem* item, uint16_t ptr){
+  if(item->data[ptr + 2] == EP_SS_ACKED){
+    publish(&(item->data[ptr + 4]), item->len - (ptr + 4));
+    setRxRef(item, ptr);
+  } else {
+    rxRefValid = false;
+  }
+  ackAndClear(item, ptr);
+}
+
+// write the ack for an acked item, wipe it, and ship the ack in the freed slot 
+void Endpoint::ackAndClear(stackItem* item, uint16_t ptr){
+  uint16_t wptr = 0;
+  payload[wptr ++] = PK_DEST;
+  if(item->data[ptr + 2] == EP_SS_ACKED_WIDE){
+    // wide ids are ack'd wide, 
+    payload[wptr ++] = EP_SS_ACK_WIDE;
+    payload[wptr ++] = item->data[ptr + 3];
+    payload[wptr ++] = item->data[ptr + 4];
+  } else {
+    payload[wptr ++] = EP_SS_ACK;
+    payload[wptr ++] = item->data[ptr + 3];
+  }
+  uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+  stackClearSlot(item);
+  stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+}
+
 // -------------------------------------------------------- Loop 
 
 void Endpoint::loop(void){
   // ok we are doing a time-based dispatch... 
   unsigned long now = millis();
+  uint32_t nowMicros = micros();
+  // everything we tx this round goes out from one version of the store, 
+  uint8_t snap = snapshot();
   EndpointRoute* routeTxList[ENDPOINT_MAX_ROUTES];
   uint8_t numTxRoutes = 0;
   // stack fresh routes, and also transition timeouts / etc, 
@@ -108,19 +341,31 @@ void Endpoint::loop(void){
   uint8_t r = lastRouteServiced;
   for(uint8_t i = 0; i < numRoutes; i ++){
     r ++; if(r >= numRoutes) r = 0;
+    // pick up freshness from writes since this route's last tx, 
+    if(routes[r]->txVersion != version){
+      if(routes[r]->state == EP_TX_IDLE){
+        routes[r]->state = EP_TX_FRESH;
+      } else if (routes[r]->state == EP_TX_AWAITING_ACK){
+        routes[r]->state = EP_TX_AWAITING_AND_FRESH;
+      }
+    }
     switch(routes[r]->state){
       case EP_TX_FRESH:
+        // paced routes w/o tokens stay fresh, and coalesce, 'til they've some 
+        if(routes[r]->tooSoon(nowMicros)) break;
         routeTxList[numTxRoutes ++] = routes[r];
         break;
       case EP_TX_AWAITING_ACK:
 				// check timeout & transition to idle state 
-        if(routes[r]->lastTxTime + routes[r]->timeoutLength > now){
+        if(routes[r]->ackIsLate(nowMicros)){
+          routes[r]->ackTimedOut();
           routes[r]->state = EP_TX_IDLE;
         }
 				break;
       case EP_TX_AWAITING_AND_FRESH:
         // check timeout & transition to fresh state 
-        if(routes[r]->lastTxTime + routes[r]->timeoutLength > now){
+        if(routes[r]->ackIsLate(nowMicros)){
+          routes[r]->ackTimedOut();
           routes[r]->state = EP_TX_FRESH;
         }
       default:
@@ -136,9 +381,10 @@ void Endpoint::loop(void){
   for(r = 0; r < numTxRoutes; r ++){
     if(stackEmptySlot(this, VT_STACK_ORIGIN)){
       // make sure we'll have enough space...
-      if(dataLen + routeTxList[r]->route->pathLen + 3 >= VT_SLOTSIZE){
-        OSAP::error("attempting to write oversized datagram at " + name, MEDIUM);
+      if(storeLen[snap] + routeTxList[r]->route->pathLen + 3 >= VT_SLOTSIZE){
+        OSAP_ERROR(TRACE_EP_TX_OVERSIZE, MEDIUM, this, storeLen[snap] + routeTxList[r]->route->pathLen + 3, r);
         routeTxList[r]->state = EP_TX_IDLE;
+        routeTxList[r]->txVersion = storeVersion[snap];
         continue;
       }
       // write dest key, mode key, & id if acked, 
@@ -146,20 +392,55 @@ void Endpoint::loop(void){
       payload[wptr ++] = PK_DEST;
       if(routeTxList[r]->ackMode == EP_ROUTEMODE_ACKLESS){
         payload[wptr ++] = EP_SS_ACKLESS;
+        memcpy(&(payload[wptr]), store[snap], storeLen[snap]);
+        wptr += storeLen[snap];
       } else {
-        payload[wptr ++] = EP_SS_ACKED;
-        payload[wptr ++] = nextAckID;
-        routeTxList[r]->ackId = nextAckID;
-        nextAckID ++;
+        EndpointRoute* rt = routeTxList[r];
+        rt->txWide = rt->useWideIds();
+        // an ack still outstanding means we've lost track of what they have, 
+        boolean lostTrack = rt->ackOutstanding;
+        takeAckId(rt, rt->txWide);
+        uint16_t deltaLen = 0;
+        if(rt->ackMode == EP_ROUTEMODE_ACKED_DELTA){
+          // delta against what they have, unless we've lost track of that (missed ack) or are due a keyframe, 
+          // and only if it comes out smaller than the frame, incl. the extra base-id byte 
+          if(rt->deltaRefValid && !lostTrack && rt->txSinceKeyframe < EP_DELTA_KEYFRAME_INTERVAL && storeLen[snap] > 1){
+            deltaLen = deltaEncode(rt->deltaRef, rt->deltaRefLen, store[snap], storeLen[snap], &(payload[wptr + 3]), storeLen[snap] - 1);
+          }
+          // this becomes the reference once it's acked, 
+          memcpy(rt->deltaPending, store[snap], storeLen[snap]);
+          rt->deltaPendingLen = storeLen[snap];
+        }
+        if(deltaLen){
+          payload[wptr ++] = EP_SS_DELTA;
+          payload[wptr ++] = rt->ackId;
+          payload[wptr ++] = rt->deltaRefId;
+          wptr += deltaLen;
+          rt->txSinceKeyframe ++;
+        } else {
+          if(rt->txWide){
+            payload[wptr ++] = EP_SS_ACKED_WIDE;
+            ts_writeUint16(rt->ackId, payload, &wptr);
+          } else {
+            payload[wptr ++] = EP_SS_ACKED;
+            payload[wptr ++] = rt->ackId;
+          }
+          memcpy(&(payload[wptr]), store[snap], storeLen[snap]);
+          wptr += storeLen[snap];
+          rt->txSinceKeyframe = 0;
+        }
       } 
-      // write data into the payload, 
-      memcpy(&(payload[wptr]), data, dataLen);
-      wptr += dataLen;
+      routeTxList[r]->txRawBytes += storeLen[snap];
+      routeTxList[r]->txWireBytes += wptr;
       // write the packet, 
       uint16_t len = writeDatagram(datagram, VT_SLOTSIZE, routeTxList[r]->route, payload, wptr);
-      // tx time is now, and state is awaiting ack, 
+      // the byte bucket pays for the whole datagram, route & all, 
+      routeTxList[r]->spendTokens(nowMicros, len);
+      // tx time is now, and state is awaiting ack, or straight back to idle for ackless routes 
       routeTxList[r]->lastTxTime = now;
-      routeTxList[r]->state = EP_TX_AWAITING_ACK;
+      routeTxList[r]->lastTxMicros = nowMicros;
+      routeTxList[r]->state = (routeTxList[r]->ackMode == EP_ROUTEMODE_ACKLESS ? EP_TX_IDLE : EP_TX_AWAITING_ACK);
+      routeTxList[r]->txVersion = storeVersion[snap];
       lastRouteServiced = r;
       // ingest it...
       stackLoadSlot(this, VT_STACK_ORIGIN, datagram, len);
@@ -177,15 +458,24 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
   switch(item->data[ptr + 2]){
     case EP_SS_ACKLESS:
       { // singlesegment transmit-to-us, w/o ack, 
-        uint8_t* rxData = &(item->data[ptr + 3]); uint16_t rxLen = item->len - (ptr + 4);
-        EP_ONDATA_RESPONSES resp = onData_cb(rxData, rxLen);
+        uint8_t* rxData = &(item->data[ptr + 3]); uint16_t rxLen = item->len - (ptr + 3);
+        if(onBorrow_cb != nullptr){
+          // zero-copy: they read it in place, or hold it 'till release(), 
+          if(onBorrow_cb(rxData, rxLen, item) == EP_BORROW_RETAIN){
+            item->borrowed = true;
+          } else {
+            stackClearSlot(item);
+          }
+          break;
+        }
+        EP_ONDATA_RESPONSES resp = onData(rxData, rxLen);
         switch(resp){
           case EP_ONDATA_WAIT:    // in a wait case, we no-op / escape, it comes back around 
             item->arrivalTime = millis();
             break;
           case EP_ONDATA_ACCEPT:  // here we copy it in, but carry on to the reject term to delete og gram
-            memcpy(data, rxData, rxLen);
-            dataLen = rxLen;
+            publish(rxData, rxLen);
+            [[fallthrough]];
           case EP_ONDATA_REJECT:  // here we simply reject it, 
             stackClearSlot(item);
             break;
@@ -193,64 +483,132 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
       }
       break;
     case EP_SS_ACKED:
-      { // singlesegment transmit-to-us, w/ ack, 
-        uint8_t id = item->data[ptr + 3];
-        uint8_t* rxData = &(item->data[ptr + 4]); uint16_t rxLen = item->len - (ptr + 5);
-        EP_ONDATA_RESPONSES resp = onData_cb(rxData, rxLen);
+    case EP_SS_ACKED_WIDE:
+      { // singlesegment transmit-to-us, w/ ack, id is one or two bytes 
+        uint16_t dptr = ptr + (item->data[ptr + 2] == EP_SS_ACKED_WIDE ? 5 : 4);
+        uint8_t* rxData = &(item->data[dptr]); uint16_t rxLen = item->len - dptr;
+        if(onBorrow_cb != nullptr){
+          // zero-copy: the ack (& the reference copy) goes out when they're done w/ the slot, 
+          if(onBorrow_cb(rxData, rxLen, item) == EP_BORROW_RETAIN){
+            item->borrowed = true;
+          } else {
+            ackBorrowed(item, ptr);
+          }
+          break;
+        }
+        EP_ONDATA_RESPONSES resp = onData(rxData, rxLen);
           switch(resp){
             case EP_ONDATA_WAIT: // this is a little danger-danger, 
               item->arrivalTime = millis();
               break;
             case EP_ONDATA_ACCEPT:
-              memcpy(data, rxData, rxLen);
-              dataLen = rxLen;
+              publish(rxData, rxLen);
+              // delta routes keyframe w/ narrow ids only, 
+              if(item->data[ptr + 2] == EP_SS_ACKED) setRxRef(item, ptr);
+              ackAndClear(item, ptr);
+              break;
             case EP_ONDATA_REJECT:
-              // write the ack, ship it, 
-              payload[0] = PK_DEST;
-              payload[1] = EP_SS_ACK;
-              payload[2] = id;
-              uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, 3);
-              stackClearSlot(item);
-              stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+              rxRefValid = false;
+              ackAndClear(item, ptr);
               break;
           }
       }
       break;
+    case EP_SS_DELTA:
+      { // singlesegment delta-against-what-we-have, w/ ack, 
+        uint8_t baseId = item->data[ptr + 4];
+        uint8_t* rxDelta = &(item->data[ptr + 5]); uint16_t rxDeltaLen = item->len - (ptr + 5);
+        // we can only rebuild it against the frame they think we have, rebuilt into the payload stash 
+        uint16_t rxLen = 0;
+        if(isRxRef(item, ptr, baseId)){
+          rxLen = deltaDecode(store[latest], storeLen[latest], rxDelta, rxDeltaLen, payload, VT_SLOTSIZE);
+        }
+        if(rxLen == 0){
+          // don't ack it: sender times out & resyncs w/ a keyframe, 
+          OSAP_DEBUG(TRACE_EP_DELTA_NO_BASE, DEFAULT, this, baseId);
+          stackClearSlot(item);
+          break;
+        }
+        if(onBorrow_cb != nullptr){
+          // the rebuilt frame doesn't live in the slot, so there's no handle to hold: RETAIN is refused, 
+          // & the frame is taken as consumed either way 
+          if(onBorrow_cb(payload, rxLen, nullptr) == EP_BORROW_RETAIN){
+            OSAP_ERROR(TRACE_EP_BORROW_NO_RETAIN, MINOR, this);
+          }
+          // it's the next delta's reference, 
+          publish(payload, rxLen);
+          setRxRef(item, ptr);
+          ackAndClear(item, ptr);
+          break;
+        }
+        EP_ONDATA_RESPONSES resp = onData(payload, rxLen);
+        switch(resp){
+          case EP_ONDATA_WAIT: // ref is untouched, so we can rebuild it next time 'round 
+            item->arrivalTime = millis();
+            break;
+          case EP_ONDATA_ACCEPT:
+            publish(payload, rxLen);
+            setRxRef(item, ptr);
+            ackAndClear(item, ptr);
+            break;
+          case EP_ONDATA_REJECT:
+            rxRefValid = false;
+            ackAndClear(item, ptr);
+            break;
+        }
+      }
+      break;
     case EP_QUERY:
       {
-        // beforeQuery, 
-        beforeQuery_cb();
-        // request for our data, 
+        // beforeQuery, unless we've refreshed recently enough: then any # of queries 
+        // in one loop (or window) are all answered from the same store version 
+        uint32_t now = millis();
+        if(!queryRefreshed || now - lastQueryRefresh >= queryFreshness){
+          beforeQuery_cb();
+          lastQueryRefresh = now;
+          queryRefreshed = true;
+        }
+        // request for our data, straight from the store into the reply, 
+        uint8_t snap = snapshot();
         payload[0] = PK_DEST;
         payload[1] = EP_QUERY_RESP;
         payload[2] = item->data[ptr + 3];
-        memcpy(&(payload[3]), data, dataLen);
-        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, dataLen + 3);
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, 3, store[snap], storeLen[snap]);
         stackClearSlot(item);
         stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
       }
       break;
     case EP_SS_ACK:
-      // acks to us, 
-      for(uint8_t r = 0; r < numRoutes; r ++){
-        if(item->data[ptr + 3] == routes[r]->ackId){
-          switch(routes[r]->state){
-            case EP_TX_AWAITING_ACK:
-              routes[r]->state = EP_TX_IDLE;
-              goto ackEnd;
-            case EP_TX_AWAITING_AND_FRESH:
-              routes[r]->state = EP_TX_FRESH;
-              goto ackEnd;
-            case EP_TX_FRESH:
-            case EP_TX_IDLE:
-            default:
-              // these are nonsense states, likely double-transmits, likely safely ignored,
-              goto ackEnd;
-          } // end switch 
+    case EP_SS_ACK_WIDE:
+      // acks to us, the ack table finds the route that's waiting on it, 
+      {
+        boolean wide = (item->data[ptr + 2] == EP_SS_ACK_WIDE);
+        uint16_t ackId = wide ? ts_readUint16(item->data, ptr + 3) : item->data[ptr + 3];
+        EndpointRoute* rt = ackTableFind(ackId);
+        // stale / double acks, or acks for removed routes, won't match & are safely ignored 
+        if(rt != nullptr && rt->txWide == wide){
+          if(wide) rt->wideConfirmed = true;
+          // ids are unique per tx, so every matched ack is a clean rtt sample, 
+          rt->rttSample(micros() - rt->lastTxMicros);
+          // the frame that was in flight is now what they have, 
+          if(rt->ackMode == EP_ROUTEMODE_ACKED_DELTA){
+            uint8_t* swap = rt->deltaRef;
+            rt->deltaRef = rt->deltaPending;
+            rt->deltaPending = swap;
+            rt->deltaRefLen = rt->deltaPendingLen;
+            rt->deltaRefId = rt->ackId;
+            rt->deltaRefValid = true;
+          }
+          ackTableRemove(rt);
+          rt->ackOutstanding = false;
+          if(rt->state == EP_TX_AWAITING_ACK){
+            rt->state = EP_TX_IDLE;
+          } else if (rt->state == EP_TX_AWAITING_AND_FRESH){
+            rt->state = EP_TX_FRESH;
+          }
         }
-      } // end for-each route, if we've reached this point, still dump it;
-      ackEnd:
-      stackClearSlot(item);
+        stackClearSlot(item);
+      }
       break;
     case EP_ROUTE_QUERY_REQ:
       // MVC request for a route of ours, 
@@ -279,6 +637,72 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
         stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
       }
       break;
+    case EP_ROUTE_STAT_REQ:
+      // MVC request for a route's rtt estimate & counts, 
+      {
+        uint8_t id = item->data[ptr + 3];
+        uint16_t r = ts_readUint16(item->data, ptr + 4);
+        uint16_t wptr = 0;
+        payload[wptr ++] = PK_DEST;
+        payload[wptr ++] = EP_ROUTE_STAT_RES;
+        payload[wptr ++] = id;
+        if(r < numRoutes){
+          payload[wptr ++] = 1;
+          ts_writeUint32(routes[r]->srtt, payload, &wptr);
+          ts_writeUint32(routes[r]->rttvar, payload, &wptr);
+          ts_writeUint32(routes[r]->rto, payload, &wptr);
+          ts_writeUint32(routes[r]->ackCount, payload, &wptr);
+          ts_writeUint32(routes[r]->timeoutCount, payload, &wptr);
+          ts_writeUint32(routes[r]->txRawBytes, payload, &wptr);
+          ts_writeUint32(routes[r]->txWireBytes, payload, &wptr);
+        } else {
+          payload[wptr ++] = 0; // no-route-here, 
+        }
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, wptr);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+      }
+      break;
+    case EP_ROUTE_RATE_REQ:
+      // MVC request to pace a route, rates of 0 un-pace it, 
+      {
+        // <id>, <route u16>, <rateDatagrams u32>, <rateBytes u32>, <burstDatagrams u16>, <burstBytes u32>, 
+        // (or a u16 burstBytes, from older requesters) anything shorter is refused 
+        if(item->len < ptr + 4){
+          stackClearSlot(item);
+          break;
+        }
+        uint8_t id = item->data[ptr + 3];
+        boolean whole = (item->len >= ptr + 18);
+        uint16_t r = (whole ? ts_readUint16(item->data, ptr + 4) : 0);
+        uint16_t rptr = ptr + 6;
+        uint32_t rateDatagrams = 0, rateBytes = 0, burstBytes = 0;
+        uint16_t burstDatagrams = 0;
+        if(whole){
+          rateDatagrams = ts_readUint32(item->data, &rptr);
+          rateBytes = ts_readUint32(item->data, &rptr);
+          burstDatagrams = ts_readUint16(item->data, rptr);
+          rptr += 2;
+          if(item->len >= rptr + 4){
+            burstBytes = ts_readUint32(item->data, &rptr);
+          } else {
+            burstBytes = ts_readUint16(item->data, rptr);
+          }
+        }
+        payload[0] = PK_DEST;
+        payload[1] = EP_ROUTE_RATE_RES;
+        payload[2] = id;
+        if(whole && r < numRoutes){
+          routes[r]->setRate(rateDatagrams, rateBytes, burstDatagrams, burstBytes);
+          payload[3] = 1;
+        } else {
+          payload[3] = 0;
+        }
+        uint16_t len = writeReply(item->data, datagram, VT_SLOTSIZE, payload, 4);
+        stackClearSlot(item);
+        stackLoadSlot(this, VT_STACK_DESTINATION, datagram, len);
+      }
+      break;
     case EP_ROUTE_SET_REQ:
       // MVC request to set a new route, 
       {
@@ -297,7 +721,7 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
           uint16_t segSize = ts_readUint16(item->data, ptr + 7);
           uint8_t* path = &(item->data[ptr + 9]);
           uint16_t pathLen = item->len - (ptr + 10);
-          OSAP::debug("adding path... w/ ttl " + String(ttl) + " ss " + String(segSize) + " pathLen " + String(pathLen));
+          OSAP_DEBUG(TRACE_EP_ROUTE_ADD, DEFAULT, this, ttl, segSize);
           uint8_t routeIndice = addRoute(new Route(path, pathLen, ttl, segSize), mode);
           payload[4] = routeIndice;
         } else {
@@ -324,7 +748,8 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
         if(r < numRoutes){
           // RM ok, 
           payload[3] = 1;
-          // delete / run destructor 
+          // drop its outstanding ack, if any, then delete / run destructor 
+          if(routes[r]->ackOutstanding) ackTableRemove(routes[r]);
           delete routes[r];
           // shift...
           for(uint8_t i = r; i < numRoutes - 1; i ++){
@@ -333,6 +758,7 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
           // last is null, 
           routes[numRoutes] = nullptr;
           numRoutes --;
+          bumpTopology();
         } else {
           // rm not-ok
           payload[3] = 0;
@@ -344,7 +770,7 @@ void Endpoint::destHandler(stackItem* item, uint16_t ptr){
       }
       break;
     default:
-      OSAP::error("endpoint rx msg w/ unrecognized endpoint key " + String(item->data[ptr + 2]) + " bailing", MINOR);
+      OSAP_ERROR(TRACE_EP_BAD_KEY, MINOR, this, item->data[ptr + 2]);
       stackClearSlot(item);
       break;
   } // end switch... 
@@ -20,16 +20,82 @@ no warranty is provided, and users accept all liability.
 
 // ---------------------------------------------- Endpoint Routes, extends OSAP Core Routes 
 
+// acked tx's take ids from one endpoint-wide sequence (8 bits, or 16 for EP_ROUTEMODE_ACKED_WIDE routes), 
+// skipping any that are still outstanding, so live ids are unique and a stale ack only matches once the 
+// sequence has wrapped... outstanding ids are found in a small open-addressed table: each route has at most 
+// one ack outstanding, so it's never more than half full 
+#define EP_ACK_TABLE_SIZE (2 * ENDPOINT_MAX_ROUTES)
+
+// bounds on the retransmit / give-up timeout, which otherwise tracks measured rtt, in us 
+#ifndef EP_RTO_MIN_US
+#define EP_RTO_MIN_US 2000 
+#endif 
+#ifndef EP_RTO_MAX_US
+#define EP_RTO_MAX_US 4000000
+#endif 
+
+// paced routes may send this many datagrams back-to-back before the rate kicks in, 
+#ifndef EP_RATE_DEFAULT_BURST
+#define EP_RATE_DEFAULT_BURST 2 
+#endif 
+
+// delta routes send a full frame (keyframe) at least this often, 
+#ifndef EP_DELTA_KEYFRAME_INTERVAL
+#define EP_DELTA_KEYFRAME_INTERVAL 32 
+#endif 
+
 enum EP_ROUTE_STATES { EP_TX_IDLE, EP_TX_FRESH, EP_TX_AWAITING_ACK, EP_TX_AWAITING_AND_FRESH };
 
 class EndpointRoute {
   public: 
     Route* route;
-    uint8_t ackId = 0;
+    uint16_t ackId = 0;
     uint8_t ackMode = EP_ROUTEMODE_ACKLESS;
+    // wide routes drop back to 8-bit ids if the far end never acks a wide one, 
+    boolean wideConfirmed = false;
+    boolean wideFallback = false;
+    boolean txWide = false;
     EP_ROUTE_STATES state = EP_TX_IDLE;
     uint32_t lastTxTime = 0;
     uint32_t timeoutLength;
+    // rtt estimator, rfc6298 style: smoothed rtt & variance drive the timeout (rto), all in us 
+    uint32_t lastTxMicros = 0;
+    uint32_t srtt = 0;
+    uint32_t rttvar = 0;
+    uint32_t rto;
+    uint32_t ackCount = 0;
+    uint32_t timeoutCount = 0;
+    // optional pacing: a datagrams/s and a bytes/s bucket (0 is unlimited, bytes are whole datagrams), kept as gcra 
+    // theoretical-arrival-times, and collapsed to one 'not before' time for the scheduler to check 
+    boolean paced = false;
+    uint32_t rateDatagrams = 0;
+    uint32_t rateBytes = 0;
+    uint32_t dgTat = 0;
+    uint32_t dgTolerance = 0;
+    uint32_t byteTat = 0;
+    uint32_t byteTolerance = 0;
+    uint32_t notBeforeMicros = 0;
+    // store version last tx'd on this route, it's fresh whenever this lags the endpoint's version 
+    uint32_t txVersion = 0;
+    // delta mode only: the last acked frame (what they have) and the one in flight, 
+    uint8_t* deltaRef = nullptr;
+    uint16_t deltaRefLen = 0;
+    uint8_t deltaRefId = 0;
+    boolean deltaRefValid = false;
+    uint8_t* deltaPending = nullptr;
+    uint16_t deltaPendingLen = 0;
+    uint16_t txSinceKeyframe = 0;
+    boolean ackOutstanding = false;
+    // data bytes we were asked to send vs. bytes that went on the wire, for reckoning delta ratios 
+    uint32_t txRawBytes = 0;
+    uint32_t txWireBytes = 0;
+    boolean useWideIds(void);
+    void ackTimedOut(void);
+    void rttSample(uint32_t rtt);
+    boolean ackIsLate(uint32_t nowMicros);
+    void setRate(uint32_t _rateDatagrams, uint32_t _rateBytes, uint16_t _burstDatagrams = EP_RATE_DEFAULT_BURST, uint32_t _burstBytes = 0);
+    boolean tooSoon(uint32_t nowMicros);
+    void spendTokens(uint32_t nowMicros, uint16_t len);
     // constructor, 
     EndpointRoute(Route* _route, uint8_t _mode, uint32_t _timeoutLength = 1000);
     // destructor...
@@ -41,30 +107,78 @@ class EndpointRoute {
 // endpoint handler responses must be one of these enum - 
 enum EP_ONDATA_RESPONSES { EP_ONDATA_REJECT, EP_ONDATA_ACCEPT, EP_ONDATA_WAIT };
 
+// zero-copy handlers get a borrowed view into the stack slot, and respond w/ one of these - 
+// CONSUMED: done w/ the view, slot is cleared (& acked) on return, 
+// RETAIN: slot is held, caller must hand the handle back w/ release() to clear (& ack) it 
+// delta frames are rebuilt outside of the slot, so they're handed over w/ a nullptr handle, and can't be 
+// retained: RETAIN is refused (w/ a TRACE_EP_BORROW_NO_RETAIN error) and the view is only valid 'till return... 
+// acked keyframes are copied into the store as they're acked, so that delta senders have a reference 
+enum EP_ONBORROW_RESPONSES { EP_BORROW_CONSUMED, EP_BORROW_RETAIN };
+
 // default handlers, 
 EP_ONDATA_RESPONSES onDataDefault(uint8_t* data, uint16_t len);
 boolean beforeQueryDefault(void);
 
 class Endpoint : public Vertex {
   public:
-    // local data store & length, 
-    uint8_t data[VT_SLOTSIZE];
+    // local data store: double buffered, write() fills whichever buffer isn't being read 
+    // and flips 'latest' to it, so grams built in loop() always carry one whole version, 
+    uint8_t store[2][VT_SLOTSIZE];
+    uint16_t storeLen[2] = { 0, 0 };
+    uint32_t storeVersion[2] = { 0, 0 };
+    volatile uint8_t latest = 0;      // most recently published buffer 
+    volatile uint8_t reading = 0;     // buffer loop() / queries are serializing from 
+    uint32_t version = 0;             // bumped on each write()
+    // latest data & length, these mirror store[latest]... n.b. data used to be a uint8_t[VT_SLOTSIZE] member, 
+    // it's now a read-only view of the latest buffer, which is only valid 'till the next write() / rx, 
+    // so code that did sizeof(ep->data) or wrote into it directly has to call write() / copy out instead 
+    const uint8_t* data(void){ return store[latest]; }
     uint16_t dataLen = 0; 
+    // queries within this many ms of the last beforeQuery_cb() are served from the store as-is, 
+    // w/o calling it again: 0 (default) calls it for every query 
+    uint32_t queryFreshness = 0;
+    uint32_t lastQueryRefresh = 0;
+    boolean queryRefreshed = false;
+    // id of the acked frame store[latest] came in on, and the path it took to get here (which is the sender's 
+    // reversed route, <= 16 hops), delta frames are only rebuilt against it if they're from the same sender... 
+    // n.b. that's one reference per endpoint: delta routes from > 1 sender to one endpoint will thrash 
+    // (deltas from the others go un-acked, so they time out & resync w/ keyframes) but never cross over 
+    uint8_t rxRefId = 0;
+    boolean rxRefValid = false;
+    uint8_t rxRefPath[32];
+    uint8_t rxRefPathLen = 0;
+    void setRxRef(stackItem* item, uint16_t ptr);
+    boolean isRxRef(stackItem* item, uint16_t ptr, uint8_t baseId);
     // callbacks: on new data & before a query is written out 
     EP_ONDATA_RESPONSES (*onData_cb)(uint8_t* data, uint16_t len) = onDataDefault;
     boolean (*beforeQuery_cb)(void) = beforeQueryDefault;
+    // if this is set, we rx in borrow mode: onData_cb is skipped and data isn't copied in 'till it's acked, 
+    EP_ONBORROW_RESPONSES (*onBorrow_cb)(uint8_t* data, uint16_t len, stackItem* handle) = nullptr;
     // we override vertex loop, 
     void loop(void) override;
     void destHandler(stackItem* item, uint16_t ptr) override;
+    // rx'd data is handed here, default is to call onData_cb, 
+    virtual EP_ONDATA_RESPONSES onData(uint8_t* _data, uint16_t len);
     // methods,
     void write(uint8_t* _data, uint16_t len);
+    void publish(uint8_t* _data, uint16_t len);
+    uint8_t snapshot(void);
+    void release(stackItem* handle);
+    void ackBorrowed(stackItem* item, uint16_t ptr);
+    void ackAndClear(stackItem* item, uint16_t ptr);
     boolean clearToWrite(void);
-    uint8_t addRoute(Route* _route, uint8_t _mode = EP_ROUTEMODE_ACKLESS, uint32_t _timeoutLength = 1000);
+    void setQueryFreshness(uint32_t ms);
+    uint8_t addRoute(Route* _route, uint8_t _mode = EP_ROUTEMODE_ACKLESS, uint32_t _timeoutLength = 1000, uint32_t _rateDatagrams = 0, uint32_t _rateBytes = 0);
     // routes, for tx-ing to:
     EndpointRoute* routes[ENDPOINT_MAX_ROUTES];
     uint16_t numRoutes = 0;
     uint16_t lastRouteServiced = 0;
-    uint8_t nextAckID = 77;
+    // outstanding-ack table, keyed by ack id, & the sequence they're drawn from 
+    EndpointRoute* ackTable[EP_ACK_TABLE_SIZE];
+    uint16_t nextAckId = 77;
+    uint16_t takeAckId(EndpointRoute* rt, boolean wide);
+    EndpointRoute* ackTableFind(uint16_t id);
+    void ackTableRemove(EndpointRoute* rt);
     // base constructor, 
     Endpoint(   
       Vertex* _parent, String _name, 
@@ -80,6 +194,13 @@ class Endpoint : public Vertex {
     ) : Endpoint ( 
       _parent, _name, _onData, nullptr
     ){};
+    // borrow-mode onData, 
+    Endpoint(   
+      Vertex* _parent, String _name,
+      EP_ONBORROW_RESPONSES (*_onBorrow)(uint8_t* data, uint16_t len, stackItem* handle)
+    ) : Endpoint ( 
+      _parent, _name, nullptr, nullptr
+    ){ onBorrow_cb = _onBorrow; };
     // beforeQuery only, 
     Endpoint(   
       Vertex* _parent, String _name, 
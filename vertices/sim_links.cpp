@@ -0,0 +1,308 @@
+/*
+osap/vertices/sim_links.cpp
+
+in-memory vport / vbus links, for wiring graphs together w/o hardware 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "sim_links.h"
+#include "../core/osap.h"
+
+// ---------------------------------------------- Frame Queue 
+
+// next frame at the tail, or nullptr if we're full, 
+SimFrame* SimFrameQueue::push(void){
+  if(full()) return nullptr;
+  SimFrame* frame = &(frames[(head + count) % SIM_LINK_QUEUE_DEPTH]);
+  count ++;
+  return frame;
+}
+
+SimFrame* SimFrameQueue::peek(void){
+  if(count == 0) return nullptr;
+  return &(frames[head]);
+}
+
+void SimFrameQueue::pop(void){
+  if(count == 0) return;
+  head = (head + 1) % SIM_LINK_QUEUE_DEPTH;
+  count --;
+}
+
+// xorshift32, 
+uint32_t simRandom(uint32_t* state){
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// true if this one goes missing, 
+static boolean simLost(SimLinkParams* params, uint32_t* state){
+  if(params->lossPerMillion == 0) return false;
+  return (simRandom(state) % 1000000) < params->lossPerMillion;
+}
+
+// us it takes to clock this many bytes onto the line, 
+static uint64_t simSerializationMicros(SimLinkParams* params, uint16_t len){
+  if(params->bitsPerSecond == 0) return 0;
+  return ((uint64_t)len * 8 * 1000000 + params->bitsPerSecond - 1) / params->bitsPerSecond;
+}
+
+// ---------------------------------------------- Point-to-Point 
+
+VPortSim::VPortSim(
+  Vertex* _parent, String _name, SimClock* _clock, SimLinkParams _params
+) : VPort(_parent, _name) {
+  clock = _clock;
+  params = _params;
+  if(params.mtu > VBUS_AGG_BUFSIZE) params.mtu = VBUS_AGG_BUFSIZE;
+  prngState = (params.seed == 0 ? 1 : params.seed);
+}
+
+VPortSim::~VPortSim(void){
+  disconnect();
+}
+
+void VPortSim::connect(VPortSim* a, VPortSim* b){
+  if(a->peer != nullptr) a->disconnect();
+  if(b->peer != nullptr) b->disconnect();
+  a->peer = b;
+  b->peer = a;
+  a->bumpTopology();
+  b->bumpTopology();
+}
+
+// drops the link at both ends, frames on the wire are lost, 
+void VPortSim::disconnect(void){
+  if(peer == nullptr) return;
+  peer->peer = nullptr;
+  peer->rxQueue.count = 0;
+  peer->bumpTopology();
+  peer = nullptr;
+  rxQueue.count = 0;
+  bumpTopology();
+}
+
+boolean VPortSim::isOpen(void){
+  return (peer != nullptr);
+}
+
+// we can send when the line is idle and the far end has somewhere to put it, 
+// so a stalled receiver backs up into our stack the way a real flowcontrolled link would 
+boolean VPortSim::cts(void){
+  if(peer == nullptr) return false;
+  if(lineFreeAt > clock->now) return false;
+  return !(peer->rxQueue.full());
+}
+
+void VPortSim::send(uint8_t* data, uint16_t len){
+  if(peer == nullptr) return;
+  if(len > params.mtu){
+    OSAP_DEBUG(TRACE_SIM_OVER_MTU, DEFAULT, this, len, params.mtu);
+    return;
+  }
+  // occupies the line whether or not it arrives, 
+  uint64_t start = (lineFreeAt > clock->now ? lineFreeAt : clock->now);
+  lineFreeAt = start + simSerializationMicros(&params, len);
+  txFrames ++;
+  txBytes += len;
+  if(simLost(&params, &prngState)){
+    lostFrames ++;
+    return;
+  }
+  SimFrame* frame = peer->rxQueue.push();
+  if(frame == nullptr){
+    lostFrames ++;
+    return;
+  }
+  memcpy(frame->data, data, len);
+  frame->len = len;
+  frame->arrival = lineFreeAt + params.latencyMicros;
+  frame->isBroadcast = false;
+}
+
+// arrivals that are due go into our origin stack, in order, while there's room 
+void VPortSim::loop(void){
+  SimFrame* frame;
+  while((frame = rxQueue.peek()) != nullptr){
+    if(frame->arrival > clock->now) break;
+    if(!stackEmptySlot(this, VT_STACK_ORIGIN)) break;
+    stackLoadSlot(this, VT_STACK_ORIGIN, frame->data, frame->len);
+    rxQueue.pop();
+  }
+}
+
+// ---------------------------------------------- Bus Medium 
+
+SimBusMedium::SimBusMedium(SimClock* _clock, SimLinkParams _params){
+  clock = _clock;
+  params = _params;
+  if(params.mtu > VBUS_AGG_BUFSIZE) params.mtu = VBUS_AGG_BUFSIZE;
+  prngState = (params.seed == 0 ? 1 : params.seed);
+  for(uint16_t d = 0; d < SIM_BUS_MAX_DROPS; d ++){
+    drops[d] = nullptr;
+  }
+}
+
+// plugs a drop in at rxAddr, and tells everyone on the wire about it, 
+boolean SimBusMedium::attach(VBusSim* drop, uint16_t rxAddr){
+  if(rxAddr >= SIM_BUS_MAX_DROPS || drops[rxAddr] != nullptr) return false;
+  drops[rxAddr] = drop;
+  drop->ownRxAddr = rxAddr;
+  drop->addrSpaceSize = SIM_BUS_MAX_DROPS;
+  for(uint16_t d = 0; d < SIM_BUS_MAX_DROPS; d ++){
+    if(drops[d] == nullptr || d == rxAddr) continue;
+    drops[d]->setLinkState(rxAddr, true);
+    drop->setLinkState(d, true);
+  }
+  return true;
+}
+
+void SimBusMedium::detach(uint16_t rxAddr){
+  if(rxAddr >= SIM_BUS_MAX_DROPS || drops[rxAddr] == nullptr) return;
+  drops[rxAddr]->rxQueue.count = 0;
+  drops[rxAddr] = nullptr;
+  for(uint16_t d = 0; d < SIM_BUS_MAX_DROPS; d ++){
+    if(drops[d] == nullptr) continue;
+    drops[d]->setLinkState(rxAddr, false);
+  }
+}
+
+// frames take turns on the line: drops wait for it w/ cts / ctb, but a send while the line is busy 
+// still queues behind it (& is tallied as contention)... returns arrival time, or 0 if the frame never shows up 
+uint64_t SimBusMedium::transmit(uint16_t len){
+  uint64_t start = clock->now;
+  if(lineFreeAt > start){
+    contendedMicros += (uint32_t)(lineFreeAt - start);
+    start = lineFreeAt;
+  }
+  lineFreeAt = start + simSerializationMicros(&params, len);
+  txFrames ++;
+  txBytes += len;
+  if(simLost(&params, &prngState)){
+    lostFrames ++;
+    return 0;
+  }
+  return lineFreeAt + params.latencyMicros;
+}
+
+// ---------------------------------------------- Bus Drops 
+
+VBusSim::VBusSim(
+  Vertex* _parent, String _name, SimBusMedium* _medium, uint16_t _rxAddr
+) : VBus(_parent, _name) {
+  medium = _medium;
+  if(!medium->attach(this, _rxAddr)){
+    OSAP_ERROR(TRACE_SIM_ATTACH, HALTING, this, _rxAddr);
+  }
+}
+
+VBusSim::~VBusSim(void){
+  if(medium->drops[ownRxAddr] == this) medium->detach(ownRxAddr);
+}
+
+// true if the line is idle, else starts (or continues) a wait for it, 
+boolean VBusSim::lineFree(void){
+  if(medium->lineFreeAt > medium->clock->now){
+    if(!lineWaiting){
+      lineWaiting = true;
+      lineWaitSince = medium->clock->now;
+    }
+    return false;
+  }
+  // the wait ended when the line did, which may be a little before we looked again 
+  if(lineWaiting){
+    medium->contendedMicros += (uint32_t)(medium->lineFreeAt - lineWaitSince);
+    lineWaiting = false;
+  }
+  return true;
+}
+
+boolean VBusSim::isOpen(uint16_t rxAddr){
+  if(rxAddr >= SIM_BUS_MAX_DROPS || rxAddr == ownRxAddr) return false;
+  return (medium->drops[rxAddr] != nullptr);
+}
+
+boolean VBusSim::cts(uint16_t rxAddr){
+  if(!isOpen(rxAddr)) return false;
+  if(!lineFree()) return false;
+  return !(medium->drops[rxAddr]->rxQueue.full());
+}
+
+// broadcasts don't wait on receivers, just on the line, 
+boolean VBusSim::ctb(uint16_t broadcastChannel){
+  (void)broadcastChannel;
+  return lineFree();
+}
+
+void VBusSim::send(uint8_t* data, uint16_t len, uint16_t rxAddr){
+  if(!isOpen(rxAddr)) return;
+  if(len > medium->params.mtu){
+    OSAP_DEBUG(TRACE_SIM_OVER_MTU, DEFAULT, this, len, medium->params.mtu);
+    return;
+  }
+  uint64_t arrival = medium->transmit(len);
+  if(arrival == 0) return;
+  SimFrame* frame = medium->drops[rxAddr]->rxQueue.push();
+  if(frame == nullptr){
+    medium->lostFrames ++;
+    return;
+  }
+  memcpy(frame->data, data, len);
+  frame->len = len;
+  frame->arrival = arrival;
+  frame->isBroadcast = false;
+  frame->arg = 0;
+}
+
+// one frame on the line, a copy at every other drop (that has room), 
+void VBusSim::broadcast(uint8_t* data, uint16_t len, uint16_t broadcastChannel){
+  if(len > medium->params.mtu){
+    OSAP_DEBUG(TRACE_SIM_OVER_MTU, DEFAULT, this, len, medium->params.mtu);
+    return;
+  }
+  uint64_t arrival = medium->transmit(len);
+  if(arrival == 0) return;
+  for(uint16_t d = 0; d < SIM_BUS_MAX_DROPS; d ++){
+    if(d == ownRxAddr || medium->drops[d] == nullptr) continue;
+    SimFrame* frame = medium->drops[d]->rxQueue.push();
+    if(frame == nullptr) continue;
+    memcpy(frame->data, data, len);
+    frame->len = len;
+    frame->arrival = arrival;
+    frame->isBroadcast = true;
+    frame->arg = broadcastChannel;
+  }
+}
+
+// due arrivals: unicasts wait for stack space, broadcasts are best-effort, as on a real bus... 
+// a unicast aggregate waits 'till every datagram in it has a slot (unless even an empty stack can't hold it), 
+// & broadcast ones go in whole or not at all, which unpackAggregate() checks 
+void VBusSim::loop(void){
+  SimFrame* frame;
+  stackItem* items[VT_STACKSIZE];
+  while((frame = rxQueue.peek()) != nullptr){
+    if(frame->arrival > medium->clock->now) break;
+    if(aggMtu > 0){
+      if(!frame->isBroadcast && !aggregateFits(frame->data, frame->len) && 
+        stackGetItems(this, VT_STACK_ORIGIN, items, VT_STACKSIZE) > 0) break;
+      unpackAggregate(frame->data, frame->len);
+    } else if(frame->isBroadcast){
+      injestBroadcastPacket(frame->data, frame->len, frame->arg);
+    } else {
+      if(!stackEmptySlot(this, VT_STACK_ORIGIN)) break;
+      stackLoadSlot(this, VT_STACK_ORIGIN, frame->data, frame->len);
+    }
+    rxQueue.pop();
+  }
+}
@@ -0,0 +1,145 @@
+/*
+osap/vertices/sim_links.h
+
+in-memory vport / vbus links, for wiring graphs together w/o hardware 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef SIM_LINKS_H_
+#define SIM_LINKS_H_
+
+#include "../core/vertex.h"
+
+// frames in flight / waiting at a receiver, per sim link end, 
+#ifndef SIM_LINK_QUEUE_DEPTH
+#define SIM_LINK_QUEUE_DEPTH 8 
+#endif 
+
+// # of drops on one sim bus, 
+#ifndef SIM_BUS_MAX_DROPS
+#define SIM_BUS_MAX_DROPS 32 
+#endif 
+
+// these links model time on a shared virtual clock, which whoever's running the sim advances, 
+// i.e. step every OSAP root's loop(), then clock.advance(us), and repeat... host shims that provide 
+// millis() / micros() can return clock.millis() / clock.micros() so that ttl's use the same time 
+class SimClock {
+  public:
+    uint64_t now = 0;
+    void advance(uint32_t us){ now += us; }
+    uint32_t micros(void){ return (uint32_t)now; }
+    uint32_t millis(void){ return (uint32_t)(now / 1000); }
+};
+
+// link properties, 
+typedef struct SimLinkParams {
+  uint32_t bitsPerSecond = 1000000;     // line rate, frames serialize at this 
+  uint32_t latencyMicros = 50;          // propagation, added after serialization 
+  uint16_t mtu = VBUS_AGG_BUFSIZE;      // larger frames are dropped at send()
+  uint32_t lossPerMillion = 0;          // chance each frame is lost, 
+  uint32_t seed = 1;                    // for the loss prng, so runs are reproducible 
+} SimLinkParams;
+
+// a frame on the wire, or waiting at the far end, 
+typedef struct SimFrame {
+  uint8_t data[VBUS_AGG_BUFSIZE];       // bus frames can be aggregates, a little larger than a slot 
+  uint16_t len = 0;
+  uint64_t arrival = 0;
+  boolean isBroadcast = false;
+  uint16_t arg = 0;                     // channel, for broadcasts 
+} SimFrame;
+
+// a fifo of those, 
+class SimFrameQueue {
+  public:
+    SimFrame frames[SIM_LINK_QUEUE_DEPTH];
+    uint8_t head = 0;
+    uint8_t count = 0;
+    boolean full(void){ return count >= SIM_LINK_QUEUE_DEPTH; }
+    SimFrame* push(void);
+    SimFrame* peek(void);
+    void pop(void);
+};
+
+// small deterministic prng, for losses, 
+uint32_t simRandom(uint32_t* state);
+
+// ---------------------------------------------- Point-to-Point 
+
+class VPortSim : public VPort {
+  public:
+    // link to whichever port is at the other end, 
+    static void connect(VPortSim* a, VPortSim* b);
+    void disconnect(void);
+    // vport api, 
+    void send(uint8_t* data, uint16_t len) override;
+    boolean cts(void) override;
+    boolean isOpen(void) override;
+    // deliver arrivals into our stack, 
+    void loop(void) override;
+    // state, 
+    SimClock* clock;
+    SimLinkParams params;
+    VPortSim* peer = nullptr;
+    SimFrameQueue rxQueue;
+    uint64_t lineFreeAt = 0;
+    uint32_t prngState;
+    // counts, 
+    uint32_t txFrames = 0;
+    uint32_t txBytes = 0;
+    uint32_t lostFrames = 0;
+    VPortSim(Vertex* _parent, String _name, SimClock* _clock, SimLinkParams _params);
+    ~VPortSim(void);
+};
+
+// ---------------------------------------------- Bus 
+
+class VBusSim;
+
+// the shared wire: one transmitter at a time, everyone else waits their turn, 
+class SimBusMedium {
+  public:
+    SimClock* clock;
+    SimLinkParams params;
+    VBusSim* drops[SIM_BUS_MAX_DROPS];
+    uint64_t lineFreeAt = 0;
+    uint32_t prngState;
+    // counts, 
+    uint32_t txFrames = 0;
+    uint32_t txBytes = 0;
+    uint32_t lostFrames = 0;
+    uint32_t contendedMicros = 0;       // time drops spent waiting for the line, w/ a frame to send 
+    boolean attach(VBusSim* drop, uint16_t rxAddr);
+    void detach(uint16_t rxAddr);
+    // schedules a frame on the line, returns its arrival time, or 0 if lost / oversize 
+    uint64_t transmit(uint16_t len);
+    SimBusMedium(SimClock* _clock, SimLinkParams _params);
+};
+
+class VBusSim : public VBus {
+  public:
+    void send(uint8_t* data, uint16_t len, uint16_t rxAddr) override;
+    void broadcast(uint8_t* data, uint16_t len, uint16_t broadcastChannel) override;
+    boolean cts(uint16_t rxAddr) override;
+    boolean ctb(uint16_t broadcastChannel) override;
+    boolean isOpen(uint16_t rxAddr) override;
+    void loop(void) override;
+    SimBusMedium* medium;
+    SimFrameQueue rxQueue;
+    // cts / ctb refuse while the line is busy, so frames wait in our stack: the wait runs from the 1st 
+    // refusal 'till the line goes free, and is tallied in the medium's contendedMicros 
+    boolean lineWaiting = false;
+    uint64_t lineWaitSince = 0;
+    boolean lineFree(void);
+    VBusSim(Vertex* _parent, String _name, SimBusMedium* _medium, uint16_t _rxAddr);
+    ~VBusSim(void);
+};
+
+#endif 
@@ -0,0 +1,141 @@
+/*
+osap/vertices/typed_endpoint.h
+
+network : software interface, w/ a compile-time data layout 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef TYPED_ENDPOINT_H_
+#define TYPED_ENDPOINT_H_
+
+#include <type_traits>
+#include "endpoint.h"
+#include "../core/osap.h"
+
+// a TypedEndpoint<T> carries one T per write: T should be a packed struct of TK_* types, that lists 
+// its fields' sizes in order, i.e. 
+// struct __attribute__((packed)) motorState { 
+//   float pos; float vel; uint32_t tick; 
+//   static constexpr uint8_t wireLayout[] = { 4, 4, 4 };
+// };
+// the wire layout is those fields, in order, little-endian, w/o padding... we check that the layout adds up 
+// to sizeof(T) at compile time, so a padded T (or a stale layout) doesn't build, 
+// on little-endian hosts pack / unpack is one memcpy, big-endian hosts swap each field in turn 
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TYPED_EP_NATIVE_LE 1 
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define TYPED_EP_NATIVE_LE 0 
+#else 
+#error "TypedEndpoint can't tell this host's byte order"
+#endif 
+
+// sum of a layout's field sizes, & whether they're all sizes we can swap, 
+template<size_t N>
+constexpr uint16_t typedWireSize(const uint8_t (&layout)[N], size_t f = 0){
+  return (f >= N ? 0 : layout[f] + typedWireSize(layout, f + 1));
+}
+
+template<size_t N>
+constexpr boolean typedLayoutValid(const uint8_t (&layout)[N], size_t f = 0){
+  return (f >= N ? true : ((layout[f] == 1 || layout[f] == 2 || layout[f] == 4 || layout[f] == 8) && typedLayoutValid(layout, f + 1)));
+}
+
+template<typename T>
+class TypedEndpoint : public Endpoint {
+  static_assert(std::is_trivially_copyable<T>::value, "TypedEndpoint<T> needs a trivially copyable T");
+  static_assert(typedLayoutValid(T::wireLayout), "TypedEndpoint<T>: T::wireLayout fields should be 1, 2, 4 or 8 bytes");
+  static_assert(sizeof(T) == typedWireSize(T::wireLayout), "TypedEndpoint<T>: sizeof(T) != the sum of T::wireLayout, T is padded (use __attribute__((packed))) or its layout is stale");
+  static_assert(sizeof(T) + 3 <= VT_SLOTSIZE, "TypedEndpoint<T> can't fit a T in one VT_SLOTSIZE segment");
+  public:
+    // bytes-on-the-wire, known statically, 
+    static const uint16_t wireSize = sizeof(T);
+    // typed callback, 
+    EP_ONDATA_RESPONSES (*onTypedData_cb)(const T& val) = nullptr;
+    // pack / unpack, 
+    static void pack(const T& val, uint8_t* buf){
+      #if TYPED_EP_NATIVE_LE 
+      memcpy(buf, &val, wireSize);
+      #else 
+      swapFields(buf, (const uint8_t*)(&val));
+      #endif 
+    }
+    static boolean unpack(uint8_t* buf, uint16_t len, T* val){
+      // exactly one T, trailing bytes are some other layout, 
+      if(len != wireSize) return false;
+      #if TYPED_EP_NATIVE_LE 
+      memcpy(val, buf, wireSize);
+      #else 
+      swapFields((uint8_t*)val, buf);
+      #endif 
+      return true;
+    }
+    // little-endian <-> host order, field by field, 
+    static void swapFields(uint8_t* dst, const uint8_t* src){
+      uint16_t offset = 0;
+      for(size_t f = 0; f < sizeof(T::wireLayout); f ++){
+        uint8_t size = T::wireLayout[f];
+        for(uint8_t b = 0; b < size; b ++) dst[offset + b] = src[offset + size - 1 - b];
+        offset += size;
+      }
+    }
+    // typed write & read, 
+    using Endpoint::write;
+    void write(const T& val){
+      #if TYPED_EP_NATIVE_LE 
+      // publish straight from the value, no staging buffer, 
+      Endpoint::write((uint8_t*)(&val), wireSize);
+      #else 
+      uint8_t buf[wireSize];
+      pack(val, buf);
+      Endpoint::write(buf, wireSize);
+      #endif 
+    }
+    T read(void){
+      T val;
+      memset(&val, 0, sizeof(T));
+      uint8_t snap = snapshot();
+      unpack(store[snap], storeLen[snap], &val);
+      return val;
+    }
+    // we override the rx hook, to unpack before handing it over, 
+    EP_ONDATA_RESPONSES onData(uint8_t* _data, uint16_t len) override {
+      if(onTypedData_cb == nullptr) return Endpoint::onData(_data, len);
+      T val;
+      if(!unpack(_data, len, &val)){
+        OSAP_ERROR(TRACE_TYPED_BAD_LEN, MINOR, this, len, wireSize);
+        return EP_ONDATA_REJECT;
+      }
+      return onTypedData_cb(val);
+    }
+    // base constructor, 
+    TypedEndpoint(
+      Vertex* _parent, String _name, 
+      EP_ONDATA_RESPONSES (*_onTypedData)(const T& val),
+      boolean (*_beforeQuery)(void)
+    ) : Endpoint(_parent, _name, nullptr, _beforeQuery) {
+      onTypedData_cb = _onTypedData;
+    };
+    // onData only, 
+    TypedEndpoint(
+      Vertex* _parent, String _name, 
+      EP_ONDATA_RESPONSES (*_onTypedData)(const T& val)
+    ) : TypedEndpoint(
+      _parent, _name, _onTypedData, nullptr
+    ){};
+    // name only, 
+    TypedEndpoint(
+      Vertex* _parent, String _name
+    ) : TypedEndpoint(
+      _parent, _name, nullptr, nullptr
+    ){};
+};
+
+#endif 
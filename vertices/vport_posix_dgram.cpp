@@ -0,0 +1,201 @@
+/*
+osap/vertices/vport_posix_dgram.cpp
+
+vport over udp or unix datagram sockets, for linux hosts 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "vport_posix_dgram.h"
+
+#if defined(__linux__)
+
+#include "../core/osap.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+
+VPortPosixDgram::VPortPosixDgram(
+  Vertex* _parent, String _name, 
+  const char* localAddr, uint16_t localPort, const char* remoteAddr, uint16_t remotePort
+) : VPort(_parent, _name) {
+  struct sockaddr_in local, remote;
+  memset(&local, 0, sizeof(local));
+  memset(&remote, 0, sizeof(remote));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(localPort);
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(remotePort);
+  if(inet_pton(AF_INET, localAddr, &(local.sin_addr)) != 1 || inet_pton(AF_INET, remoteAddr, &(remote.sin_addr)) != 1){
+    OSAP::error("posix dgram " + name + " bad ipv4 address", MEDIUM);
+    return;
+  }
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  setup(fd, &local, sizeof(local), &remote, sizeof(remote));
+}
+
+VPortPosixDgram::VPortPosixDgram(
+  Vertex* _parent, String _name, const char* localPath, const char* remotePath
+) : VPort(_parent, _name) {
+  struct sockaddr_un local, remote;
+  memset(&local, 0, sizeof(local));
+  memset(&remote, 0, sizeof(remote));
+  local.sun_family = AF_UNIX;
+  remote.sun_family = AF_UNIX;
+  if(strlen(localPath) >= sizeof(local.sun_path) || strlen(remotePath) >= sizeof(remote.sun_path)){
+    OSAP::error("posix dgram " + name + " socket path too long", MEDIUM);
+    return;
+  }
+  strcpy(local.sun_path, localPath);
+  strcpy(remote.sun_path, remotePath);
+  unlink(localPath);
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  setup(fd, &local, sizeof(local), &remote, sizeof(remote));
+}
+
+VPortPosixDgram::~VPortPosixDgram(void){
+  close();
+}
+
+void VPortPosixDgram::setup(int fd, const void* local, uint32_t localLen, const void* _remote, uint32_t _remoteLen){
+  if(fd < 0){
+    OSAP::error("posix dgram " + name + " can't open socket, errno " + String(errno), MEDIUM);
+    return;
+  }
+  if(bind(fd, (const struct sockaddr*)local, localLen) != 0){
+    OSAP::error("posix dgram " + name + " can't bind, errno " + String(errno), MEDIUM);
+    ::close(fd);
+    return;
+  }
+  memcpy(remote, _remote, _remoteLen);
+  remoteLen = _remoteLen;
+  // unix sockets refuse to connect til the peer has bound, we retry at flush() 
+  connect(fd, (const struct sockaddr*)remote, remoteLen);
+  pb.fd = fd;
+  if(!posixPollAdd(&pb)){
+    OSAP::error("posix dgram " + name + " can't register w/ epoll", MEDIUM);
+  }
+}
+
+void VPortPosixDgram::close(void){
+  if(pb.fd < 0) return;
+  posixPollRemove(&pb);
+  ::close(pb.fd);
+  pb.fd = -1;
+}
+
+// datagram links are connectionless, so we're open as long as we have a socket, 
+boolean VPortPosixDgram::isOpen(void){
+  return (pb.fd >= 0);
+}
+
+boolean VPortPosixDgram::cts(void){
+  return (pb.fd >= 0 && txCount < VPORT_DGRAM_TX_FRAMES && pb.writable);
+}
+
+void VPortPosixDgram::send(uint8_t* data, uint16_t len){
+  if(pb.fd < 0 || txCount >= VPORT_DGRAM_TX_FRAMES || len > VT_SLOTSIZE) return;
+  uint8_t t = (txHead + txCount) % VPORT_DGRAM_TX_FRAMES;
+  memcpy(txFrames[t], data, len);
+  txLens[t] = len;
+  txCount ++;
+}
+
+void VPortPosixDgram::flush(void){
+  if(pb.fd < 0 || txCount == 0 || !pb.writable) return;
+  struct mmsghdr msgs[VPORT_DGRAM_TX_FRAMES];
+  struct iovec iov[VPORT_DGRAM_TX_FRAMES];
+  memset(msgs, 0, sizeof(struct mmsghdr) * txCount);
+  for(uint8_t f = 0; f < txCount; f ++){
+    uint8_t t = (txHead + f) % VPORT_DGRAM_TX_FRAMES;
+    iov[f].iov_base = txFrames[t];
+    iov[f].iov_len = txLens[t];
+    msgs[f].msg_hdr.msg_iov = &(iov[f]);
+    msgs[f].msg_hdr.msg_iovlen = 1;
+  }
+  int sent = sendmmsg(pb.fd, msgs, txCount, MSG_DONTWAIT);
+  txCalls ++;
+  if(sent < 0){
+    if(errno == EAGAIN || errno == EWOULDBLOCK){
+      pb.writable = false;
+      return;
+    }
+    // nobody listening (yet): these are lost, as they would be on any lossy link, 
+    if(errno == ECONNREFUSED || errno == ENOTCONN || errno == ENOENT){
+      txRefused += txCount;
+      txHead = (txHead + txCount) % VPORT_DGRAM_TX_FRAMES;
+      txCount = 0;
+      connect(pb.fd, (const struct sockaddr*)remote, remoteLen);
+      return;
+    }
+    OSAP::error("posix dgram " + name + " sendmmsg errno " + String(errno), MEDIUM);
+    return;
+  }
+  txDatagrams += sent;
+  txHead = (txHead + sent) % VPORT_DGRAM_TX_FRAMES;
+  txCount -= sent;
+  if(txCount > 0) pb.writable = false;
+}
+
+void VPortPosixDgram::loop(void){
+  if(pb.fd < 0) return;
+  // async errors (i.e. icmp port unreachable) land here, we just clear them 
+  if(pb.hangup){
+    int err = 0;
+    socklen_t errLen = sizeof(err);
+    getsockopt(pb.fd, SOL_SOCKET, SO_ERROR, &err, &errLen);
+    pb.hangup = false;
+  }
+  while(pb.readable){
+    // recv straight into as many slots as we have, 
+    stackItem* slots[VT_STACKSIZE];
+    uint8_t count = stackReserveSlots(this, VT_STACK_ORIGIN, slots, VT_STACKSIZE);
+    if(count == 0) break;
+    struct mmsghdr msgs[VT_STACKSIZE];
+    struct iovec iov[VT_STACKSIZE];
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for(uint8_t s = 0; s < count; s ++){
+      iov[s].iov_base = slots[s]->data;
+      iov[s].iov_len = VT_SLOTSIZE;
+      msgs[s].msg_hdr.msg_iov = &(iov[s]);
+      msgs[s].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(pb.fd, msgs, count, MSG_DONTWAIT, nullptr);
+    rxCalls ++;
+    if(n < 0){
+      if(errno == EAGAIN || errno == EWOULDBLOCK) pb.readable = false;
+      break;
+    }
+    // commit in order... a dropped (oversize / empty) datagram leaves a gap, 
+    // so anything after it is copied back into the slot that's actually next 
+    uint8_t next = 0;
+    for(int m = 0; m < n; m ++){
+      uint16_t len = msgs[m].msg_len;
+      if(len == 0 || (msgs[m].msg_hdr.msg_flags & MSG_TRUNC)){
+        rxTruncated ++;
+        continue;
+      }
+      if(next != m) memcpy(slots[next]->data, slots[m]->data, len);
+      stackCommitSlot(slots[next], len);
+      next ++;
+    }
+    rxDatagrams += next;
+    // a short batch means the socket's empty, 
+    if(n < count){
+      pb.readable = false;
+      break;
+    }
+  }
+  flush();
+}
+
+#endif 
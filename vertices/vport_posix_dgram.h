@@ -0,0 +1,64 @@
+/*
+osap/vertices/vport_posix_dgram.h
+
+vport over udp or unix datagram sockets, for linux hosts 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef VPORT_POSIX_DGRAM_H_
+#define VPORT_POSIX_DGRAM_H_
+
+#if defined(__linux__)
+
+#include "../core/vertex.h"
+#include "../utils/posix_poll.h"
+
+// # of datagrams we'll hold for the next sendmmsg(), 
+#ifndef VPORT_DGRAM_TX_FRAMES
+#define VPORT_DGRAM_TX_FRAMES 16 
+#endif 
+
+// one osap datagram is one socket datagram, so there's no framing: each recvmmsg() 
+// lands directly in a run of reserved origin-stack slots, and each loop sends everything 
+// queued w/ one sendmmsg() 
+class VPortPosixDgram : public VPort {
+  public:
+    void send(uint8_t* data, uint16_t len) override;
+    boolean cts(void) override;
+    boolean isOpen(void) override;
+    void loop(void) override;
+    void flush(void);
+    void close(void);
+    PosixPollable pb;
+    // tx queue, 
+    uint8_t txFrames[VPORT_DGRAM_TX_FRAMES][VT_SLOTSIZE];
+    uint16_t txLens[VPORT_DGRAM_TX_FRAMES];
+    uint8_t txHead = 0;
+    uint8_t txCount = 0;
+    // counts, 
+    uint32_t rxCalls = 0;
+    uint32_t rxDatagrams = 0;
+    uint32_t rxTruncated = 0;
+    uint32_t txCalls = 0;
+    uint32_t txDatagrams = 0;
+    uint32_t txRefused = 0;
+    // udp (ipv4): bound to localAddr:localPort, connected to remoteAddr:remotePort 
+    VPortPosixDgram(Vertex* _parent, String _name, const char* localAddr, uint16_t localPort, const char* remoteAddr, uint16_t remotePort);
+    // unix datagram: bound to localPath (which we unlink 1st), connected to remotePath 
+    VPortPosixDgram(Vertex* _parent, String _name, const char* localPath, const char* remotePath);
+    ~VPortPosixDgram(void);
+  private: 
+    void setup(int fd, const void* local, uint32_t localLen, const void* remote, uint32_t remoteLen);
+    uint32_t remoteLen = 0;
+    uint8_t remote[112];       // room for a sockaddr_un, to reconnect if the peer comes back 
+};
+
+#endif 
+#endif 
@@ -0,0 +1,186 @@
+/*
+osap/vertices/vport_posix_serial.cpp
+
+vport over a tty / pty, for linux hosts 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "vport_posix_serial.h"
+
+#if defined(__linux__)
+
+#include "../core/osap.h"
+#include "../utils/cobs.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+static speed_t baudToSpeed(uint32_t baud){
+  switch(baud){
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default: return B0;
+  }
+}
+
+VPortPosixSerial::VPortPosixSerial(
+  Vertex* _parent, String _name, const char* path, uint32_t baud
+) : VPort(_parent, _name) {
+  int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if(fd < 0){
+    OSAP::error("posix serial " + name + " can't open " + String(path) + ", errno " + String(errno), MEDIUM);
+    return;
+  }
+  // raw, 8n1, 
+  struct termios tio;
+  if(tcgetattr(fd, &tio) == 0){
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    speed_t speed = baudToSpeed(baud);
+    if(speed != B0) cfsetspeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  setup(fd);
+}
+
+VPortPosixSerial::VPortPosixSerial(
+  Vertex* _parent, String _name, int fd
+) : VPort(_parent, _name) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  setup(fd);
+}
+
+VPortPosixSerial::~VPortPosixSerial(void){
+  close();
+}
+
+void VPortPosixSerial::setup(int fd){
+  pb.fd = fd;
+  if(!posixPollAdd(&pb)){
+    OSAP::error("posix serial " + name + " can't register w/ epoll", MEDIUM);
+  }
+}
+
+void VPortPosixSerial::close(void){
+  if(pb.fd < 0) return;
+  posixPollRemove(&pb);
+  ::close(pb.fd);
+  pb.fd = -1;
+}
+
+boolean VPortPosixSerial::isOpen(void){
+  return (pb.fd >= 0 && !pb.hangup);
+}
+
+boolean VPortPosixSerial::cts(void){
+  return (isOpen() && txCount < VPORT_POSIX_TX_FRAMES && pb.writable);
+}
+
+void VPortPosixSerial::send(uint8_t* data, uint16_t len){
+  if(!isOpen() || txCount >= VPORT_POSIX_TX_FRAMES || len > VT_SLOTSIZE) return;
+  uint8_t t = (txHead + txCount) % VPORT_POSIX_TX_FRAMES;
+  size_t ecl = cobsEncodeFast(data, len, txFrames[t]);
+  txFrames[t][ecl] = 0;
+  txLens[t] = ecl + 1;
+  txCount ++;
+}
+
+// every queued frame in one writev, partial writes pick up where they left off 
+void VPortPosixSerial::flush(void){
+  if(!isOpen() || txCount == 0 || !pb.writable) return;
+  struct iovec iov[VPORT_POSIX_TX_FRAMES];
+  for(uint8_t f = 0; f < txCount; f ++){
+    uint8_t t = (txHead + f) % VPORT_POSIX_TX_FRAMES;
+    uint16_t offset = (f == 0 ? txHeadOffset : 0);
+    iov[f].iov_base = &(txFrames[t][offset]);
+    iov[f].iov_len = txLens[t] - offset;
+  }
+  ssize_t written = writev(pb.fd, iov, txCount);
+  writevCalls ++;
+  if(written < 0){
+    if(errno == EAGAIN || errno == EWOULDBLOCK){
+      // kernel's full: wait for epoll to say otherwise, 
+      pb.writable = false;
+    } else {
+      OSAP::error("posix serial " + name + " writev errno " + String(errno), MEDIUM);
+      pb.hangup = true;
+    }
+    return;
+  }
+  if(written > 0) pb.hangup = false;
+  // retire whatever went out, 
+  while(txCount > 0 && written > 0){
+    uint16_t remaining = txLens[txHead] - txHeadOffset;
+    if(written >= remaining){
+      written -= remaining;
+      txHeadOffset = 0;
+      txHead = (txHead + 1) % VPORT_POSIX_TX_FRAMES;
+      txCount --;
+      txFramesWritten ++;
+    } else {
+      txHeadOffset += written;
+      written = 0;
+    }
+  }
+  // a short write means the kernel's buffer is full, 
+  if(txCount > 0) pb.writable = false;
+}
+
+void VPortPosixSerial::loop(void){
+  if(pb.fd < 0) return;
+  // a hangup isn't always for good, so once in a while we drop it & probe w/ a read, which sets it again 
+  // if the line's still down 
+  if(pb.hangup){
+    if(!hangupTiming){
+      hangupTiming = true;
+      hangupSince = millis();
+    } else if (millis() - hangupSince >= VPORT_POSIX_HANGUP_RETRY_MS){
+      hangupTiming = false;
+      pb.hangup = false;
+      pb.readable = true;
+      pb.writable = true;
+    }
+  } else {
+    hangupTiming = false;
+  }
+  // whatever didn't fit in the stack last time goes 1st, 
+  if(rxOffset < rxLen){
+    rxOffset += injestStream(&(rxBuf[rxOffset]), rxLen - rxOffset);
+  }
+  // then read til the kernel's empty, or we're backed up, 
+  while(pb.readable && rxOffset >= rxLen){
+    ssize_t n = read(pb.fd, rxBuf, VPORT_POSIX_RX_BUFSIZE);
+    if(n < 0){
+      if(errno == EAGAIN || errno == EWOULDBLOCK) pb.readable = false;
+      else pb.hangup = true;
+      break;
+    } else if (n == 0){
+      pb.hangup = true;
+      break;
+    }
+    pb.hangup = false;
+    rxLen = n;
+    rxOffset = injestStream(rxBuf, rxLen);
+  }
+  flush();
+}
+
+#endif 
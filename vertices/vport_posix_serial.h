@@ -0,0 +1,80 @@
+/*
+osap/vertices/vport_posix_serial.h
+
+vport over a tty / pty, for linux hosts 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef VPORT_POSIX_SERIAL_H_
+#define VPORT_POSIX_SERIAL_H_
+
+#if defined(__linux__)
+
+#include "../core/vertex.h"
+#include "../utils/posix_poll.h"
+#include <sys/uio.h>
+
+// # of encoded frames we'll hold for the next writev(), 
+#ifndef VPORT_POSIX_TX_FRAMES
+#define VPORT_POSIX_TX_FRAMES 16 
+#endif 
+
+#ifndef VPORT_POSIX_RX_BUFSIZE
+#define VPORT_POSIX_RX_BUFSIZE 4096 
+#endif 
+
+// a hung-up port is probed again this often, in case the far end came back (i.e. a pty reopened) 
+#ifndef VPORT_POSIX_HANGUP_RETRY_MS
+#define VPORT_POSIX_HANGUP_RETRY_MS 100 
+#endif 
+
+// worst case cobs'd slot, + the delimiter 
+#define VPORT_POSIX_FRAME_MAX (VT_SLOTSIZE + VT_SLOTSIZE / 254 + 2)
+
+class VPortPosixSerial : public VPort {
+  public:
+    // frames are cobs'd into the tx queue at send(), and the whole queue goes out in one writev() 
+    // per loop... cts() is false while the queue is full or the kernel's tx buffer is, 
+    void send(uint8_t* data, uint16_t len) override;
+    boolean cts(void) override;
+    boolean isOpen(void) override;
+    void loop(void) override;
+    // to push the queue out before the next loop, 
+    void flush(void);
+    void close(void);
+    // the fd, & its readiness, 
+    PosixPollable pb;
+    // tx queue, 
+    uint8_t txFrames[VPORT_POSIX_TX_FRAMES][VPORT_POSIX_FRAME_MAX];
+    uint16_t txLens[VPORT_POSIX_TX_FRAMES];
+    uint8_t txHead = 0;
+    uint8_t txCount = 0;
+    uint16_t txHeadOffset = 0;      // bytes of the head frame already written, 
+    // rx: bytes read but not yet taken by injestStream(), 
+    uint8_t rxBuf[VPORT_POSIX_RX_BUFSIZE];
+    uint16_t rxLen = 0;
+    uint16_t rxOffset = 0;
+    // hangups are latched 'till a read or write goes thru, or the next probe, 
+    boolean hangupTiming = false;
+    uint32_t hangupSince = 0;
+    // counts, 
+    uint32_t writevCalls = 0;
+    uint32_t txFramesWritten = 0;
+    // opens path, nonblocking & raw, at baud if it's a real tty (pty's ignore it) 
+    VPortPosixSerial(Vertex* _parent, String _name, const char* path, uint32_t baud = 0);
+    // or takes an fd that's already open (i.e. one end of a pty pair) 
+    VPortPosixSerial(Vertex* _parent, String _name, int fd);
+    ~VPortPosixSerial(void);
+  private: 
+    void setup(int fd);
+};
+
+#endif 
+#endif 
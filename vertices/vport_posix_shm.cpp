@@ -0,0 +1,200 @@
+/*
+osap/vertices/vport_posix_shm.cpp
+
+vport over a pair of spsc rings in shared memory, between processes on one linux host 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "vport_posix_shm.h"
+
+#if defined(__linux__)
+
+#include "../core/osap.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm rings need lock-free 32 bit atomics");
+static_assert((VPORT_SHM_RING_SLOTS & (VPORT_SHM_RING_SLOTS - 1)) == 0, "VPORT_SHM_RING_SLOTS should be a power of two");
+
+// shared (not process-private) futex ops, since the word lives in a mapping between processes 
+static void futexWake(std::atomic<uint32_t>* word){
+  syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutUs){
+  struct timespec ts;
+  ts.tv_sec = timeoutUs / 1000000;
+  ts.tv_nsec = (timeoutUs % 1000000) * 1000;
+  syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+// true if the process w/ this pid is still around, 
+static boolean shmPidAlive(uint32_t pid){
+  if(pid == 0) return false;
+  return (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+VPortPosixShm::VPortPosixShm(
+  Vertex* _parent, String _name, const char* path, uint8_t _side
+) : VPort(_parent, _name) {
+  side = (_side ? 1 : 0);
+  int fd = open(path, O_RDWR | O_CLOEXEC | (side == 0 ? O_CREAT : 0), 0600);
+  if(fd < 0){
+    OSAP::error("posix shm " + name + " can't open " + String(path) + ", errno " + String(errno), MEDIUM);
+    return;
+  }
+  // a short file can't be a region, side 0 sizes it, side 1 shouldn't map past its end 
+  struct stat st;
+  boolean sized = (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ShmRegion));
+  if(!sized && (side == 1 || ftruncate(fd, sizeof(ShmRegion)) != 0)){
+    OSAP::error("posix shm " + name + " can't size " + String(path), MEDIUM);
+    ::close(fd);
+    return;
+  }
+  void* map = mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED){
+    OSAP::error("posix shm " + name + " can't map " + String(path) + ", errno " + String(errno), MEDIUM);
+    return;
+  }
+  region = (ShmRegion*)map;
+  boolean valid = (region->magic == VPORT_SHM_MAGIC && region->slotSize == VT_SLOTSIZE && region->numSlots == VPORT_SHM_RING_SLOTS);
+  if(!valid && side == 1){
+    OSAP::error("posix shm " + name + " region at " + String(path) + " isn't ours, or is configured differently", MEDIUM);
+    munmap(region, sizeof(ShmRegion));
+    region = nullptr;
+    return;
+  }
+  // one process per side: a live one keeps it, a dead one's is taken over, 
+  uint32_t was = (valid ? region->attached[side].load(std::memory_order_acquire) : 0);
+  if(shmPidAlive(was)){
+    OSAP::error("posix shm " + name + " side " + String(side) + " at " + String(path) + " is held by pid " + String(was), MEDIUM);
+    munmap(region, sizeof(ShmRegion));
+    region = nullptr;
+    return;
+  }
+  // side 0 starts the rings fresh unless a live side 1 is using them, in which case we pick up where 
+  // the last side 0 left off... magic goes last, 
+  if(side == 0 && (!valid || !shmPidAlive(region->attached[1].load(std::memory_order_acquire)))){
+    region->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    for(uint8_t r = 0; r < 2; r ++){
+      region->rings[r].head.value.store(0, std::memory_order_relaxed);
+      region->rings[r].tail.value.store(0, std::memory_order_relaxed);
+      region->rings[r].waiting.value.store(0, std::memory_order_relaxed);
+      region->attached[r].store(0, std::memory_order_relaxed);
+    }
+    region->slotSize = VT_SLOTSIZE;
+    region->numSlots = VPORT_SHM_RING_SLOTS;
+    std::atomic_thread_fence(std::memory_order_release);
+    region->magic = VPORT_SHM_MAGIC;
+    was = 0;
+  }
+  if(!region->attached[side].compare_exchange_strong(was, (uint32_t)getpid())){
+    OSAP::error("posix shm " + name + " side " + String(side) + " at " + String(path) + " is held by pid " + String(was), MEDIUM);
+    munmap(region, sizeof(ShmRegion));
+    region = nullptr;
+    return;
+  }
+  txRing = &(region->rings[side]);
+  rxRing = &(region->rings[side ^ 1]);
+  txTailCache = txRing->tail.value.load(std::memory_order_acquire);
+}
+
+VPortPosixShm::~VPortPosixShm(void){
+  close();
+}
+
+void VPortPosixShm::close(void){
+  if(region == nullptr) return;
+  // only if it's still ours, 
+  uint32_t self = (uint32_t)getpid();
+  region->attached[side].compare_exchange_strong(self, 0, std::memory_order_release);
+  munmap(region, sizeof(ShmRegion));
+  region = nullptr;
+}
+
+boolean VPortPosixShm::isOpen(void){
+  if(region == nullptr) return false;
+  uint32_t peer = region->attached[side ^ 1].load(std::memory_order_acquire);
+  if(peer == 0) return false;
+  // a peer that died w/o closing leaves its pid behind, so every so often we check that it's still around, 
+  if(peer != peerPid || millis() - peerCheckedAt >= VPORT_SHM_LIVENESS_MS){
+    peerPid = peer;
+    peerAlive = shmPidAlive(peer);
+    peerCheckedAt = millis();
+  }
+  return peerAlive;
+}
+
+boolean VPortPosixShm::cts(void){
+  if(!isOpen()) return false;
+  uint32_t head = txRing->head.value.load(std::memory_order_relaxed);
+  if(head - txTailCache < VPORT_SHM_RING_SLOTS) return true;
+  txTailCache = txRing->tail.value.load(std::memory_order_acquire);
+  return (head - txTailCache < VPORT_SHM_RING_SLOTS);
+}
+
+void VPortPosixShm::send(uint8_t* data, uint16_t len){
+  if(!cts() || len > VT_SLOTSIZE) return;
+  uint32_t head = txRing->head.value.load(std::memory_order_relaxed);
+  ShmSlot* slot = &(txRing->slots[head & (VPORT_SHM_RING_SLOTS - 1)]);
+  memcpy(slot->data, data, len);
+  slot->len = len;
+  // seq_cst, so the waiting check below can't be reordered ahead of it 
+  txRing->head.value.store(head + 1, std::memory_order_seq_cst);
+  txFrames ++;
+  if(useFutex && txRing->waiting.value.load(std::memory_order_seq_cst)){
+    futexWake(&(txRing->head.value));
+    wakeups ++;
+  }
+}
+
+void VPortPosixShm::loop(void){
+  if(region == nullptr) return;
+  uint32_t tail = rxRing->tail.value.load(std::memory_order_relaxed);
+  uint32_t head = rxRing->head.value.load(std::memory_order_acquire);
+  while(tail != head){
+    stackItem* item = stackReserveSlot(this, VT_STACK_ORIGIN);
+    if(item == nullptr) break;
+    ShmSlot* slot = &(rxRing->slots[tail & (VPORT_SHM_RING_SLOTS - 1)]);
+    uint16_t len = slot->len;
+    if(len > VT_SLOTSIZE) len = VT_SLOTSIZE;
+    memcpy(item->data, slot->data, len);
+    stackCommitSlot(item, len);
+    tail ++;
+    rxFrames ++;
+  }
+  rxRing->tail.value.store(tail, std::memory_order_release);
+}
+
+boolean VPortPosixShm::waitForRx(uint32_t timeoutUs){
+  if(region == nullptr) return false;
+  uint32_t head = rxRing->head.value.load(std::memory_order_seq_cst);
+  if(head != rxRing->tail.value.load(std::memory_order_relaxed)) return true;
+  if(!useFutex) return false;
+  rxRing->waiting.value.store(1, std::memory_order_seq_cst);
+  // re-check after raising the flag, else a send() in between would never wake us 
+  head = rxRing->head.value.load(std::memory_order_seq_cst);
+  if(head == rxRing->tail.value.load(std::memory_order_relaxed)){
+    futexWait(&(rxRing->head.value), head, timeoutUs);
+  }
+  rxRing->waiting.value.store(0, std::memory_order_relaxed);
+  return (rxRing->head.value.load(std::memory_order_acquire) != rxRing->tail.value.load(std::memory_order_relaxed));
+}
+
+#endif 
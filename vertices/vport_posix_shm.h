@@ -0,0 +1,98 @@
+/*
+osap/vertices/vport_posix_shm.h
+
+vport over a pair of spsc rings in shared memory, between processes on one linux host 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef VPORT_POSIX_SHM_H_
+#define VPORT_POSIX_SHM_H_
+
+#if defined(__linux__)
+
+#include "../core/vertex.h"
+#include <atomic>
+
+// slots per direction, a power of two, 
+#ifndef VPORT_SHM_RING_SLOTS
+#define VPORT_SHM_RING_SLOTS 64 
+#endif 
+
+// a side's process is checked for (w/ kill(pid, 0)) at most this often, 
+#ifndef VPORT_SHM_LIVENESS_MS
+#define VPORT_SHM_LIVENESS_MS 100 
+#endif 
+
+#define VPORT_SHM_MAGIC 0x4f534d32 
+
+// indices each get a cache line, so producer and consumer don't false-share 
+typedef struct alignas(64) ShmIndex {
+  std::atomic<uint32_t> value;
+} ShmIndex;
+
+typedef struct ShmSlot {
+  uint16_t len;
+  uint8_t data[VT_SLOTSIZE];
+} ShmSlot;
+
+// one direction: head is written by the producer only, tail by the consumer only, 
+// and the consumer raises waiting before it sleeps on head (w/ a futex) 
+typedef struct ShmRing {
+  ShmIndex head;
+  ShmIndex tail;
+  ShmIndex waiting;
+  ShmSlot slots[VPORT_SHM_RING_SLOTS];
+} ShmRing;
+
+typedef struct ShmRegion {
+  uint32_t magic;
+  uint32_t slotSize;
+  uint32_t numSlots;
+  // pid of the process at each side, 0 if none... a side that crashes leaves its pid here, so the 
+  // other checks that it's still around, & a new process can take over a side whose pid is gone 
+  // (n.b. that's pids as seen from each side, so both should be in the same pid namespace) 
+  std::atomic<uint32_t> attached[2];
+  ShmRing rings[2];             // rings[0] is side 0 -> side 1, rings[1] the other way 
+} ShmRegion;
+
+class VPortPosixShm : public VPort {
+  public:
+    // send() copies straight into the tx ring, loop() copies rx'd frames straight into our origin stack, 
+    // cts() is true while the tx ring has a free slot 
+    void send(uint8_t* data, uint16_t len) override;
+    boolean cts(void) override;
+    boolean isOpen(void) override;
+    void loop(void) override;
+    // for hosts w/ nothing else to do: sleeps til the peer sends something, or timeoutUs passes 
+    boolean waitForRx(uint32_t timeoutUs);
+    void close(void);
+    ShmRegion* region = nullptr;
+    uint8_t side = 0;
+    ShmRing* txRing = nullptr;
+    ShmRing* rxRing = nullptr;
+    // producer-local copy of the consumer's tail, only refreshed when the ring looks full 
+    uint32_t txTailCache = 0;
+    // futex wakeups, on by default, 
+    boolean useFutex = true;
+    uint32_t txFrames = 0;
+    uint32_t rxFrames = 0;
+    uint32_t wakeups = 0;
+    // last liveness check on the peer, 
+    uint32_t peerPid = 0;
+    boolean peerAlive = false;
+    uint32_t peerCheckedAt = 0;
+    // side 0 creates the file at path (i.e. /dev/shm/osap-link) if need be, side 1 attaches to it... either is 
+    // refused while another live process holds that side, and side 0 only resets the rings if no one's using them 
+    VPortPosixShm(Vertex* _parent, String _name, const char* path, uint8_t _side);
+    ~VPortPosixShm(void);
+};
+
+#endif 
+#endif 
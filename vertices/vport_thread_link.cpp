@@ -0,0 +1,117 @@
+/*
+osap/vertices/vport_thread_link.cpp
+
+lock-free vport pair, between roots running on different threads of one host process 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#include "vport_thread_link.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include "../core/osap.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif 
+
+static_assert((VPORT_THREAD_LINK_SLOTS & (VPORT_THREAD_LINK_SLOTS - 1)) == 0, "VPORT_THREAD_LINK_SLOTS should be a power of two");
+
+VPortThreadLink::VPortThreadLink(
+  Vertex* _parent, String _name
+) : VPort(_parent, _name) {}
+
+VPortThreadLink::~VPortThreadLink(void){
+  disconnect();
+}
+
+// the rings live in a link that both ends hold a reference to, 
+void VPortThreadLink::connect(VPortThreadLink* a, VPortThreadLink* b){
+  a->disconnect();
+  b->disconnect();
+  ThreadLink* link = new ThreadLink;
+  for(uint8_t r = 0; r < 2; r ++){
+    link->rings[r].head.store(0);
+    link->rings[r].tail.store(0);
+    link->attached[r].store(true);
+  }
+  link->refs.store(2);
+  a->link = link;
+  a->side = 0;
+  a->txRing = &(link->rings[0]);
+  a->rxRing = &(link->rings[1]);
+  a->txTailCache = 0;
+  b->link = link;
+  b->side = 1;
+  b->txRing = &(link->rings[1]);
+  b->rxRing = &(link->rings[0]);
+  b->txTailCache = 0;
+}
+
+void VPortThreadLink::disconnect(void){
+  if(link == nullptr) return;
+  link->attached[side].store(false, std::memory_order_release);
+  if(link->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete link;
+  link = nullptr;
+  txRing = nullptr;
+  rxRing = nullptr;
+}
+
+boolean VPortThreadLink::isOpen(void){
+  return (link != nullptr && link->attached[1 - side].load(std::memory_order_acquire));
+}
+
+boolean VPortThreadLink::cts(void){
+  if(!isOpen()) return false;
+  uint32_t head = txRing->head.load(std::memory_order_relaxed);
+  if(head - txTailCache < VPORT_THREAD_LINK_SLOTS) return true;
+  txTailCache = txRing->tail.load(std::memory_order_acquire);
+  return (head - txTailCache < VPORT_THREAD_LINK_SLOTS);
+}
+
+void VPortThreadLink::send(uint8_t* data, uint16_t len){
+  if(!cts() || len > VT_SLOTSIZE) return;
+  uint32_t head = txRing->head.load(std::memory_order_relaxed);
+  uint32_t s = head & (VPORT_THREAD_LINK_SLOTS - 1);
+  memcpy(txRing->data[s], data, len);
+  txRing->lens[s] = len;
+  txRing->head.store(head + 1, std::memory_order_release);
+  txFrames ++;
+}
+
+// straight from the ring into our origin stack, while there's room, 
+void VPortThreadLink::loop(void){
+  if(rxRing == nullptr) return;
+  uint32_t tail = rxRing->tail.load(std::memory_order_relaxed);
+  uint32_t head = rxRing->head.load(std::memory_order_acquire);
+  while(tail != head){
+    stackItem* item = stackReserveSlot(this, VT_STACK_ORIGIN);
+    if(item == nullptr) break;
+    uint32_t s = tail & (VPORT_THREAD_LINK_SLOTS - 1);
+    memcpy(item->data, rxRing->data[s], rxRing->lens[s]);
+    stackCommitSlot(item, rxRing->lens[s]);
+    tail ++;
+    rxFrames ++;
+  }
+  rxRing->tail.store(tail, std::memory_order_release);
+}
+
+boolean pinCurrentThread(uint16_t core){
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#else 
+  return false;
+#endif 
+}
+
+#endif 
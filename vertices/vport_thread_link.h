@@ -0,0 +1,73 @@
+/*
+osap/vertices/vport_thread_link.h
+
+lock-free vport pair, between roots running on different threads of one host process 
+
+Jake Read at the Center for Bits and Atoms
+(c) Massachusetts Institute of Technology 2022
+
+This work may be reproduced, modified, distributed, performed, and
+displayed for any purpose, but must acknowledge the osap project.
+Copyright is retained and must be preserved. The work is provided as is;
+no warranty is provided, and users accept all liability.
+*/
+
+#ifndef VPORT_THREAD_LINK_H_
+#define VPORT_THREAD_LINK_H_
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include "../core/vertex.h"
+#include <atomic>
+
+// slots per direction, a power of two, 
+#ifndef VPORT_THREAD_LINK_SLOTS
+#define VPORT_THREAD_LINK_SLOTS 32 
+#endif 
+
+// one direction, spsc: head is only written by the sending thread, tail by the receiving one, 
+// each on its own cache line 
+typedef struct ThreadLinkRing {
+  alignas(64) std::atomic<uint32_t> head;
+  alignas(64) std::atomic<uint32_t> tail;
+  alignas(64) uint16_t lens[VPORT_THREAD_LINK_SLOTS];
+  uint8_t data[VPORT_THREAD_LINK_SLOTS][VT_SLOTSIZE];
+} ThreadLinkRing;
+
+// both directions, shared by the two ends: whichever one detaches last frees it, 
+// so either root can be torn down 1st 
+typedef struct ThreadLink {
+  ThreadLinkRing rings[2];            // rings[0] is side 0 -> side 1, rings[1] the other way 
+  std::atomic<boolean> attached[2];
+  std::atomic<uint8_t> refs;
+} ThreadLink;
+
+// a sharded host runs one root per thread (pinned w/ pinCurrentThread()), each w/ its own 
+// loop state (see OSAP_THREAD_LOCAL), and joins them up w/ these: connect() both ends before 
+// the threads start, after which each end is only touched by its own root's thread 
+class VPortThreadLink : public VPort {
+  public:
+    static void connect(VPortThreadLink* a, VPortThreadLink* b);
+    // drops our end, the peer sees the link close (& frees it, if it's already gone) 
+    void disconnect(void);
+    void send(uint8_t* data, uint16_t len) override;
+    boolean cts(void) override;
+    boolean isOpen(void) override;
+    void loop(void) override;
+    ThreadLink* link = nullptr;
+    uint8_t side = 0;
+    ThreadLinkRing* txRing = nullptr;
+    ThreadLinkRing* rxRing = nullptr;
+    // sender's copy of the receiver's tail, only refreshed when the ring looks full 
+    uint32_t txTailCache = 0;
+    uint32_t txFrames = 0;
+    uint32_t rxFrames = 0;
+    VPortThreadLink(Vertex* _parent, String _name);
+    ~VPortThreadLink(void);
+};
+
+// pins the calling thread to one core, false if the os won't (or can't) 
+boolean pinCurrentThread(uint16_t core);
+
+#endif 
+#endif 